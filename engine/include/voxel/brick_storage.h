@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+
+#include <voxel/types.h>
+#include <voxel/voxel.h>
+
+namespace voxel {
+    // Разреженное хранилище вокселей: модель разбита на кирпичи 8x8x8.
+    // Однородный кирпич (пустой или сплошной одного цвета) хранит только цвет,
+    // память под ячейки выделяется лишь для неоднородных кирпичей.
+    class brick_storage {
+    public:
+        static constexpr int BRICK_SHIFT = 3;
+        static constexpr int BRICK_SIZE = 1 << BRICK_SHIFT;
+        static constexpr int BRICK_MASK = BRICK_SIZE - 1;
+        static constexpr int BRICK_VOLUME = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+        brick_storage() = default;
+        brick_storage(int width, int height, int depth);
+
+        voxel get(int x, int y, int z) const {
+            const brick& b = bricks_[brick_index(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT)];
+            if (b.slot == NO_SLOT) {
+                return b.uniform;
+            }
+            return pool_[b.slot + local_index(x, y, z)];
+        }
+
+        void set(int x, int y, int z, const voxel& value);
+        void fill(const voxel& value);
+
+        // Схлопывает ставшие однородными кирпичи и освобождает их память
+        void optimize();
+
+        // Сетка кирпичей
+        int bricks_x() const { return bricks_x_; }
+        int bricks_y() const { return bricks_y_; }
+        int bricks_z() const { return bricks_z_; }
+
+        // Однородный кирпич: uniform получает его цвет (0 - пустой)
+        bool is_brick_uniform(int bx, int by, int bz, voxel& uniform) const {
+            const brick& b = bricks_[brick_index(bx, by, bz)];
+            uniform = b.uniform;
+            return b.slot == NO_SLOT;
+        }
+
+        size_t allocated_brick_count() const { return pool_.size() / BRICK_VOLUME - free_slots_.size(); }
+        size_t memory_usage() const;
+
+    private:
+        static constexpr uint32 NO_SLOT = 0xFFFFFFFFu;
+
+        struct brick {
+            voxel uniform;          // Цвет однородного кирпича
+            uint32 slot = NO_SLOT;  // Смещение ячеек в pool_ для неоднородного кирпича
+        };
+
+        size_t brick_index(int bx, int by, int bz) const {
+            return bx + static_cast<size_t>(by) * bricks_x_ + static_cast<size_t>(bz) * bricks_x_ * bricks_y_;
+        }
+        static uint32 local_index(int x, int y, int z) {
+            return (x & BRICK_MASK) | ((y & BRICK_MASK) << BRICK_SHIFT) | ((z & BRICK_MASK) << (2 * BRICK_SHIFT));
+        }
+
+        uint32 allocate_slot(const voxel& value);
+        void release_slot(brick& b);
+
+        int bricks_x_ = 0, bricks_y_ = 0, bricks_z_ = 0;
+        std::vector<brick> bricks_;
+        std::vector<voxel> pool_;        // Ячейки неоднородных кирпичей подряд
+        std::vector<uint32> free_slots_; // Освобожденные участки pool_
+    };
+}
@@ -4,6 +4,7 @@
 #include <vulkan/vulkan.h>
 
 #include <voxel/types.h>
+#include <voxel/gpu_allocator.h>
 
 namespace voxel {
     class vulkan_context;
@@ -27,9 +28,12 @@ namespace voxel {
         buffer& operator=(buffer&& other) noexcept;
 
         VkBuffer get_buffer() const { return buffer_; }
-        VkDeviceMemory get_memory() const { return memory_; }
+        VkDeviceMemory get_memory() const { return allocation_.memory; }
+        VkDeviceSize get_memory_offset() const { return allocation_.offset; }
+        const gpu_allocation& get_allocation() const { return allocation_; }
         VkDeviceSize get_size() const { return size_; }
 
+        // Память участка HOST_VISIBLE отображена постоянно (см. gpu_allocator)
         void* map();
         void unmap();
         void copy_from(const void* data, VkDeviceSize size, VkDeviceSize offset = 0);
@@ -46,12 +50,10 @@ namespace voxel {
 
     private:
         void cleanup();
-        uint32_t find_memory_type(uint32_t type_filter, VkMemoryPropertyFlags properties);
 
         std::shared_ptr<vulkan_context> context_;
         VkBuffer buffer_;
-        VkDeviceMemory memory_;
-        void* mapped_memory_;
+        gpu_allocation allocation_;
     };
 
     // Специализированные типы буферов
@@ -66,6 +68,18 @@ namespace voxel {
                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
             ) {}
+
+        // Буфер с заданными свойствами памяти, заполняемый копированием (upload_queue)
+        vertex_buffer(
+            std::shared_ptr<vulkan_context> context,
+            VkDeviceSize size,
+            VkMemoryPropertyFlags properties
+        ) : buffer(
+                context,
+                size,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                properties
+            ) {}
         
         template<typename T>
         vertex_buffer(
@@ -93,6 +107,18 @@ namespace voxel {
                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
             ) {}
 
+        // Буфер с заданными свойствами памяти, заполняемый копированием (upload_queue)
+        index_buffer(
+            std::shared_ptr<vulkan_context> context,
+            VkDeviceSize size,
+            VkMemoryPropertyFlags properties
+        ) : buffer(
+                context,
+                size,
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                properties
+            ) {}
+
         template<typename T>
         index_buffer(
             std::shared_ptr<vulkan_context> context,
@@ -107,6 +133,70 @@ namespace voxel {
         }
     };
 
+    class storage_buffer : public buffer {
+    public:
+        storage_buffer(
+            std::shared_ptr<vulkan_context> context,
+            VkDeviceSize size
+        ) : buffer(
+                context,
+                size,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            ) {}
+
+        // Буфер с заданными свойствами памяти, заполняемый копированием (upload_queue)
+        storage_buffer(
+            std::shared_ptr<vulkan_context> context,
+            VkDeviceSize size,
+            VkMemoryPropertyFlags properties
+        ) : buffer(
+                context,
+                size,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                properties
+            ) {}
+
+        template<typename T>
+        storage_buffer(
+            std::shared_ptr<vulkan_context> context,
+            const std::vector<T>& elements
+        ) : buffer(
+                context,
+                sizeof(T) * elements.size(),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            ) {
+            copy_from(elements.data(), size_);
+        }
+    };
+
+    // Команды косвенной отрисовки (VkDrawIndexedIndirectCommand), записываемые CPU
+    class indirect_buffer : public buffer {
+    public:
+        indirect_buffer(
+            std::shared_ptr<vulkan_context> context,
+            VkDeviceSize size
+        ) : buffer(
+                context,
+                size,
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            ) {}
+
+        // Команды и их число, записываемые шейдером (отсечение на GPU)
+        indirect_buffer(
+            std::shared_ptr<vulkan_context> context,
+            VkDeviceSize size,
+            VkMemoryPropertyFlags properties
+        ) : buffer(
+                context,
+                size,
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                properties
+            ) {}
+    };
+
     class uniform_buffer : public buffer {
     public:
         uniform_buffer(
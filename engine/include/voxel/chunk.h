@@ -0,0 +1,53 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+
+#include <voxel/types.h>
+#include <voxel/model.h>
+
+namespace voxel {
+    // Размер чанка ландшафта (в вокселях по каждой оси)
+    constexpr int CHUNK_SHIFT = 5;
+    constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+    constexpr int CHUNK_MASK = CHUNK_SIZE - 1;
+
+    // Целочисленные координаты чанка: блок (x, y, z) лежит в чанке (x >> CHUNK_SHIFT, ...)
+    using chunk_coord = vec3i;
+
+    struct chunk_coord_hash {
+        size_t operator()(const chunk_coord& c) const {
+            return static_cast<size_t>(
+                (static_cast<uint64>(static_cast<uint32>(c.x)) * 73856093ull) ^
+                (static_cast<uint64>(static_cast<uint32>(c.y)) * 19349663ull) ^
+                (static_cast<uint64>(static_cast<uint32>(c.z)) * 83492791ull)
+            );
+        }
+    };
+
+    // Чанк для блока с мировыми координатами (округление вниз и для отрицательных)
+    inline chunk_coord block_to_chunk(int x, int y, int z) {
+        return chunk_coord(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+    }
+
+    // Чанк ландшафта
+    struct chunk {
+        chunk_coord coord;               // Координаты в сетке чанков
+        std::shared_ptr<model> pmodel;   // Воксели чанка CHUNK_SIZE^3 (nullptr у холодного чанка)
+        std::vector<uint8> cold_data;    // Сжатые воксели холодного чанка (chunk_codec)
+        object_id object = 0;            // Объект мира, через который чанк мешится и рисуется
+        bool mesh_dirty = false;         // Изменен после последней постановки меша в очередь
+        bool save_dirty = false;         // Изменен после последнего сохранения
+
+        chunk(const chunk_coord& coord, std::shared_ptr<model> pmodel)
+            : coord(coord), pmodel(std::move(pmodel)) {}
+
+        bool is_cold() const { return pmodel == nullptr; }
+    };
+
+    using chunk_map = std::unordered_map<chunk_coord, std::shared_ptr<chunk>, chunk_coord_hash>;
+
+    // Неизменяемый снимок модели чанка для сохранения
+    using chunk_snapshot = std::pair<chunk_coord, std::shared_ptr<const model>>;
+}
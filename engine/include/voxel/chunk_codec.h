@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <memory>
+
+#include <voxel/types.h>
+#include <voxel/model.h>
+
+namespace voxel {
+    // Сжатие моделей чанков для файлов регионов и "холодных" чанков в памяти.
+    // Воксели переводятся в индексы палитры, индексы кодируются сериями вдоль
+    // оси X (самой быстрой), поток серий сжимается LZ-компрессором в стиле LZ4.
+    class chunk_codec {
+    public:
+        static std::vector<uint8> encode(const model& chunk_model);
+
+        // Бросает std::runtime_error для поврежденных данных
+        static std::shared_ptr<model> decode(const uint8* data, size_t size);
+        static std::shared_ptr<model> decode(const std::vector<uint8>& data) {
+            return decode(data.data(), data.size());
+        }
+
+    private:
+        static void write_varint(std::vector<uint8>& out, uint32 value);
+        static uint32 read_varint(const uint8*& in, const uint8* end);
+
+        static std::vector<uint8> compress(const uint8* data, size_t size);
+        static std::vector<uint8> decompress(const uint8* data, size_t size, size_t decompressed_size);
+    };
+}
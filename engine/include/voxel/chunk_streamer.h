@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+#include <voxel/types.h>
+#include <voxel/model.h>
+#include <voxel/chunk.h>
+
+namespace voxel {
+    class world;
+    class world_storage;
+
+    // Подгрузка чанков вокруг камеры: чанки в радиусе загрузки загружаются или
+    // генерируются в фоновых потоках (ближние - первыми) и добавляются в мир,
+    // чанки за радиусом выгрузки удаляются из мира.
+    class chunk_streamer {
+    public:
+        // Заполняет модель чанка; возвращает false, если чанк пуст.
+        // Вызывается из фоновых потоков.
+        using generator = std::function<bool(const chunk_coord& coord, model& chunk_model)>;
+
+        // thread_count = 0 - половина аппаратных потоков
+        chunk_streamer(std::shared_ptr<world> world, generator generate, size_t thread_count = 0);
+        ~chunk_streamer();
+
+        // Запретить копирование и перемещение
+        chunk_streamer(const chunk_streamer&) = delete;
+        chunk_streamer& operator=(const chunk_streamer&) = delete;
+
+        // Радиусы в чанках; радиус выгрузки не меньше радиуса загрузки
+        void set_radius(int load_radius, int unload_radius);
+        int get_load_radius() const { return load_radius_; }
+        int get_unload_radius() const { return unload_radius_; }
+
+        // Чанки дальше радиуса "холода" хранятся в памяти сжатыми (0 - не сжимать)
+        void set_cold_radius(int radius);
+        int get_cold_radius() const { return cold_radius_; }
+
+        // Сохраненные чанки загружаются вместо генерации, измененные
+        // чанки сохраняются при выгрузке
+        void set_storage(std::shared_ptr<world_storage> storage);
+
+        // Диапазон чанков по вертикали (по умолчанию - мир высотой 1024 блока)
+        void set_height_range(int min_chunk_y, int max_chunk_y);
+
+        // Вызывается каждый кадр до world::update_meshes
+        void update(const vec3f& camera_position);
+
+        size_t get_resident_count() const { return resident_.size(); }
+        size_t get_pending_count() const { return requested_.size(); }
+
+    private:
+        struct generated_chunk {
+            chunk_coord coord;
+            std::shared_ptr<model> pmodel;
+            bool has_content;
+            bool failed; // Ошибка загрузки - чанк запрашивается повторно
+        };
+
+        bool in_radius(const chunk_coord& coord, int radius) const;
+        void request_missing();
+        void integrate_generated();
+        void evict_distant();
+        void update_cold_chunks();
+        void worker_function();
+
+        std::shared_ptr<world> world_;
+        generator generate_;
+        std::shared_ptr<world_storage> storage_; // Защищен mutex_
+
+        int load_radius_ = 8;
+        int unload_radius_ = 10;
+        int cold_radius_ = 0;
+        int min_chunk_y_ = 0;
+        int max_chunk_y_ = 1024 / CHUNK_SIZE - 1;
+
+        chunk_coord center_;
+        bool refresh_ = true; // Центр или радиусы изменились
+
+        // Состояние основного потока
+        std::unordered_set<chunk_coord, chunk_coord_hash> resident_;  // Загруженные чанки, включая пустые
+        std::unordered_set<chunk_coord, chunk_coord_hash> requested_; // Поставленные в генерацию
+
+        // Обмен с фоновыми потоками
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<chunk_coord> queue_;
+        std::vector<generated_chunk> completed_;
+        bool stop_ = false;
+        std::vector<std::thread> threads_;
+    };
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <exception>
+#include <vulkan/vulkan.h>
+
+#include <voxel/types.h>
+
+namespace voxel {
+    class vulkan_context;
+
+    // Параллельная запись вторичных command buffer внутри render pass.
+    // У каждого рабочего потока свой VkCommandPool на каждый кадр в полете:
+    // пул сбрасывается целиком при первой записи кадра, без блокировок между потоками.
+    // record вызывается из одного (основного) потока.
+    class command_recorder {
+    public:
+        // Записывает в command_buffer участок range; вызывается из рабочих потоков
+        using record_function = std::function<void(VkCommandBuffer command_buffer, size_t range)>;
+
+        // thread_count = 0 - default_thread_count()
+        command_recorder(std::shared_ptr<vulkan_context> context, uint32 frame_count, size_t thread_count = 0);
+        ~command_recorder();
+
+        // Запретить копирование
+        command_recorder(const command_recorder&) = delete;
+        command_recorder& operator=(const command_recorder&) = delete;
+
+        // Записывает range_count вторичных буферов (участок i - потоком i % get_thread_count())
+        // и возвращает их в порядке участков. Буферы кадра frame переиспользуются
+        // при следующей записи этого кадра: к этому моменту GPU должен их выполнить.
+        // Исключение из record_range пробрасывается после завершения всех потоков
+        const std::vector<VkCommandBuffer>& record(
+            uint32 frame,
+            const VkCommandBufferInheritanceInfo& inheritance,
+            size_t range_count,
+            const record_function& record_range
+        );
+
+        size_t get_thread_count() const { return workers_.size(); }
+
+        static size_t default_thread_count();
+
+    private:
+        static constexpr size_t MAX_DEFAULT_THREADS = 4;
+
+        struct frame_pool {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> buffers;
+        };
+
+        struct worker {
+            std::thread thread;
+            std::vector<frame_pool> frames;
+            std::exception_ptr error;
+        };
+
+        void worker_function(size_t index);
+
+        std::shared_ptr<vulkan_context> context_;
+        std::vector<std::unique_ptr<worker>> workers_;
+
+        std::mutex mutex_;
+        std::condition_variable start_cv_;
+        std::condition_variable done_cv_;
+        uint64 job_ = 0;          // Номер текущего задания
+        size_t active_ = 0;       // Потоки, еще не закончившие задание
+        bool stopping_ = false;
+
+        // Текущее задание; читается потоками после смены job_
+        uint32 job_frame_ = 0;
+        const VkCommandBufferInheritanceInfo* job_inheritance_ = nullptr;
+        size_t job_range_count_ = 0;
+        const record_function* job_record_ = nullptr;
+        std::vector<VkCommandBuffer> results_;
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string_view>
+#include <vector>
 #include <memory>
 #include <chrono>
 
@@ -10,6 +11,7 @@
 #include "game_logic.h"
 #include "events.h"
 #include "world.h"
+#include "world_storage.h"
 
 namespace voxel {
     class engine : public std::enable_shared_from_this<engine> {
@@ -43,6 +45,14 @@ namespace voxel {
         std::shared_ptr<world> get_world() { return world_; }
         std::shared_ptr<world> get_world() const { return world_; }
 
+        // Пул потоков генерации мешей (0 - по числу аппаратных потоков)
+        void set_mesh_thread_count(size_t thread_count) { world_->set_mesh_thread_count(thread_count); }
+        std::vector<size_t> get_mesh_queue_depths() const { return world_->get_mesh_queue_depths(); }
+
+        // Сохранение мира: автосохранение в update, финальное сохранение в shutdown
+        void set_world_storage(std::shared_ptr<world_storage> storage) { world_storage_ = std::move(storage); }
+        std::shared_ptr<world_storage> get_world_storage() const { return world_storage_; }
+
         // Методы для работы с игровой логикой
         void set_game_logic(std::unique_ptr<game_logic> logic);
         game_logic* get_game_logic() { return game_logic_.get(); }
@@ -61,6 +71,7 @@ namespace voxel {
         std::shared_ptr<renderer> renderer_;
         std::shared_ptr<camera> camera_;
         std::shared_ptr<world> world_;
+        std::shared_ptr<world_storage> world_storage_;
         
         std::unique_ptr<game_logic> game_logic_;
         
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+#include <voxel/types.h>
+
+namespace voxel {
+    // Ограничивающий параллелепипед, выровненный по осям
+    struct aabb {
+        vec3f min;
+        vec3f max;
+
+        vec3f center() const { return (min + max) * 0.5f; }
+        vec3f extent() const { return (max - min) * 0.5f; }
+    };
+
+    // Набор AABB в виде структуры массивов (центр и полуразмер по осям):
+    // проверка пирамидой идет по непрерывным массивам float и векторизуется
+    struct aabb_batch {
+        std::vector<float> center_x, center_y, center_z;
+        std::vector<float> extent_x, extent_y, extent_z;
+
+        void clear();
+        void reserve(size_t count);
+        void push_back(const aabb& box);
+        size_t size() const { return center_x.size(); }
+    };
+
+    // Пирамида видимости из матрицы view * projection (вектор-строка,
+    // как в шейдерах): плоскости обращены внутрь и нормализованы
+    class frustum {
+    public:
+        struct plane {
+            float x, y, z, w; // x*px + y*py + z*pz + w >= 0 - внутри
+        };
+
+        explicit frustum(const mat4f& view_projection);
+
+        bool intersects(const aabb& box) const;
+
+        // visible[i] = 1, если boxes[i] пересекает пирамиду, иначе 0.
+        // Возвращает число видимых
+        size_t test(const aabb_batch& boxes, uint8* visible) const;
+
+        const plane* get_planes() const { return planes_; }
+
+    private:
+        plane planes_[6]; // left, right, bottom, top, near, far
+    };
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
+#include <vulkan/vulkan.h>
+
+#include <voxel/types.h>
+
+namespace voxel {
+    struct gpu_memory_block;
+
+    // Участок памяти, выделенный gpu_allocator
+    struct gpu_allocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        VkDeviceSize alignment = 1;
+        void* mapped = nullptr;           // Адрес участка, если память HOST_VISIBLE
+        void* user_data = nullptr;        // Владелец (для переноса при дефрагментации)
+        uint32 memory_type = 0;
+        gpu_memory_block* block = nullptr; // nullptr - выделенная отдельно память
+
+        explicit operator bool() const { return memory != VK_NULL_HANDLE; }
+    };
+
+    struct gpu_allocator_stats {
+        size_t block_count = 0;           // Блоки общего пользования
+        size_t dedicated_count = 0;       // Отдельные vkAllocateMemory для крупных ресурсов
+        size_t allocation_count = 0;      // Живые участки (включая отдельные)
+        VkDeviceSize reserved_bytes = 0;  // Память, полученная от драйвера
+        VkDeviceSize used_bytes = 0;      // Память, занятая участками
+        VkDeviceSize largest_free_range = 0;
+        size_t free_range_count = 0;      // Число свободных промежутков - мера фрагментации
+    };
+
+    // Блок памяти одного типа, из которого нарезаются участки
+    struct gpu_memory_block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+        uint32 memory_type = 0;
+        VkDeviceSize used_bytes = 0;
+
+        std::map<VkDeviceSize, VkDeviceSize> free_by_offset;     // offset -> size, для слияния соседей
+        std::multimap<VkDeviceSize, VkDeviceSize> free_by_size;  // size -> offset, для best-fit
+        std::unordered_map<VkDeviceSize, gpu_allocation> used;   // offset -> участок
+    };
+
+    // Распределитель памяти устройства: участки нарезаются из крупных блоков
+    // (best-fit по списку свободных промежутков с учетом выравнивания, соседние
+    // промежутки сливаются при освобождении). Ресурсы больше половины блока
+    // получают отдельную память. HOST_VISIBLE блоки отображены постоянно.
+    // Потокобезопасен.
+    class gpu_allocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+        gpu_allocator(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize block_size = DEFAULT_BLOCK_SIZE);
+        ~gpu_allocator();
+
+        // Запретить копирование
+        gpu_allocator(const gpu_allocator&) = delete;
+        gpu_allocator& operator=(const gpu_allocator&) = delete;
+
+        gpu_allocation allocate(
+            const VkMemoryRequirements& requirements,
+            VkMemoryPropertyFlags properties,
+            void* user_data = nullptr
+        );
+        // Выделяет и привязывает память изображения. Изображения делят блоки с буферами:
+        // участок выравнивается по bufferImageGranularity, чтобы они не попали на одну страницу
+        gpu_allocation allocate_image(VkImage image, VkMemoryPropertyFlags properties);
+        void free(gpu_allocation& allocation);
+
+        // Хук дефрагментации: участки с user_data из наименее заполненных блоков
+        // переносятся в свободные промежутки других блоков. move(from, to) должен
+        // перенести данные владельца в to (новый VkBuffer, копирование) и вернуть true;
+        // после этого from освобождается. При false новый участок возвращается.
+        // Возвращает число переносов; опустевшие блоки освобождаются.
+        size_t defragment(
+            const std::function<bool(const gpu_allocation& from, const gpu_allocation& to)>& move,
+            size_t max_moves = SIZE_MAX
+        );
+
+        // Возвращает драйверу пустые блоки
+        void release_empty_blocks();
+
+        gpu_allocator_stats get_stats() const;
+        uint32 find_memory_type(uint32 type_filter, VkMemoryPropertyFlags properties) const;
+
+    private:
+        bool try_allocate_from(gpu_memory_block& block, VkDeviceSize size, VkDeviceSize alignment, void* user_data, gpu_allocation& result);
+        void add_free_range(gpu_memory_block& block, VkDeviceSize offset, VkDeviceSize size);
+        void remove_free_range(gpu_memory_block& block, VkDeviceSize offset, VkDeviceSize size);
+        void release_range(gpu_memory_block& block, VkDeviceSize offset, VkDeviceSize size);
+        gpu_memory_block& create_block(uint32 memory_type);
+        void destroy_block(gpu_memory_block& block);
+
+        VkDevice device_;
+        VkPhysicalDeviceMemoryProperties memory_properties_{};
+        VkDeviceSize buffer_image_granularity_ = 1;
+        VkDeviceSize block_size_;
+
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<gpu_memory_block>> blocks_;
+        size_t dedicated_count_ = 0;
+        VkDeviceSize dedicated_bytes_ = 0;
+    };
+}
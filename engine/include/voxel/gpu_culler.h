@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <vulkan/vulkan.h>
+
+#include <voxel/types.h>
+#include <voxel/buffer.h>
+#include <voxel/frustum.h>
+#include <voxel/mesh_arena.h>
+#include <voxel/transform.h>
+
+namespace voxel {
+    class vulkan_context;
+    class shader;
+    class hiz_pyramid;
+
+    // Отсечение мешей арены пирамидой видимости и перекрытием на GPU: compute шейдер
+    // (shaders/cull_comp.spv) проверяет AABB объектов и пишет сжатый буфер
+    // команд, который рисуется vkCmdDrawIndexedIndirectCountKHR без участия CPU.
+    // Перекрытие проверяется по пирамиде глубины прошлого кадра (hiz_pyramid).
+    // Матрицы объекта i (модели и нормалей) - элемент i буфера матриц (set 1 pipeline экземпляров).
+    // Требует VK_KHR_draw_indirect_count и drawIndirectFirstInstance.
+    // Буферы свои у каждого кадра в полете.
+    class gpu_culler {
+    public:
+        static constexpr uint32 WORKGROUP_SIZE = 64;
+
+        // max_draw_count - maxDrawIndirectCount: столько команд рисуется одним вызовом.
+        // pyramid - пирамида глубины, читаемая шейдером (см. set_depth_pyramid)
+        gpu_culler(std::shared_ptr<vulkan_context> context, uint32 frame_count, uint32 max_draw_count, const hiz_pyramid& pyramid);
+        ~gpu_culler();
+
+        // Запретить копирование
+        gpu_culler(const gpu_culler&) = delete;
+        gpu_culler& operator=(const gpu_culler&) = delete;
+
+        // Начинает набор объектов кадра frame
+        void begin(uint32 frame);
+        void add(const aabb& bounds, const transform& model_transform, const mesh_arena_range& range);
+        size_t get_object_count() const { return objects_.size(); }
+
+        // Обновляет пирамиду глубины после её пересоздания (GPU не использует наборы)
+        void set_depth_pyramid(const hiz_pyramid& pyramid);
+
+        // Вне render pass: загружает объекты, обнуляет счетчики и запускает отсечение.
+        // occlusion - проверять перекрытие (если пирамида уже построена)
+        void dispatch(VkCommandBuffer command_buffer, const frustum& view_frustum, bool occlusion);
+        // Внутри render pass: pipeline экземпляров (layout - его layout) и буферы арены
+        // уже привязаны; привязывает матрицы объектов в set 1 и рисует видимые
+        void draw(VkCommandBuffer command_buffer, VkPipelineLayout instanced_layout);
+
+    private:
+        // Элемент буфера объектов (std430, см. cull.comp)
+        struct cull_object {
+            float center[4];
+            float extent[4];
+            uint32 index_count;
+            uint32 first_index;
+            int32 vertex_offset;
+            uint32 padding;
+        };
+
+        // Элемент буфера матриц: модель и нормали (std430 {mat4; mat3}, см. voxel_instanced.vert)
+        struct object_transform {
+            alignas(16) float model[16];
+            alignas(16) float normal[12];
+        };
+        static_assert(sizeof(object_transform) == 112, "object_transform must match std430 {mat4; mat3}");
+
+        struct cull_push_constants {
+            float planes[6][4];
+            uint32 object_count;
+            uint32 draw_chunk_size;
+        };
+
+        // Параметры перекрытия (std140, см. cull.comp): матрица, с которой нарисована
+        // глубина пирамиды, размер буфера глубины и число уровней
+        struct occlusion_params {
+            float view_projection[16];
+            float depth_size[2];
+            uint32 level_count;
+            uint32 enabled;
+        };
+
+        struct frame_resources {
+            std::unique_ptr<storage_buffer> objects;
+            std::unique_ptr<storage_buffer> transforms;
+            std::unique_ptr<indirect_buffer> commands;
+            std::unique_ptr<indirect_buffer> counts;
+            std::unique_ptr<uniform_buffer> occlusion;
+            VkDescriptorSet cull_set = VK_NULL_HANDLE;      // Объекты, команды, счетчики, перекрытие
+            VkDescriptorSet transform_set = VK_NULL_HANDLE; // Матрицы для вершинного шейдера
+            size_t capacity = 0;
+        };
+
+        void create_pipeline();
+        void create_descriptors(uint32 frame_count);
+        void ensure_capacity(frame_resources& frame, size_t object_count);
+        uint32 get_chunk_count() const;
+
+        std::shared_ptr<vulkan_context> context_;
+        const hiz_pyramid* pyramid_;
+        std::unique_ptr<shader> shader_;
+        VkDescriptorSetLayout set_layout_;
+        VkPipelineLayout pipeline_layout_;
+        VkPipeline pipeline_;
+        VkDescriptorPool descriptor_pool_;
+        uint32 max_draw_count_;
+
+        std::vector<frame_resources> frames_;
+        uint32 frame_ = 0;
+        std::vector<cull_object> objects_;
+        std::vector<object_transform> transforms_;
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <vulkan/vulkan.h>
+
+#include <voxel/types.h>
+#include <voxel/gpu_allocator.h>
+
+namespace voxel {
+    class vulkan_context;
+    class shader;
+
+    // Иерархический буфер глубины для отсечения перекрытием: mip-пирамида R32_SFLOAT,
+    // каждый тексел которой - максимальная (самая дальняя) глубина своего участка.
+    // Строится compute шейдером (shaders/hiz_comp.spv) из буфера глубины кадра после
+    // render pass и проверяется отсечением следующего кадра с матрицей вида-проекции,
+    // с которой эта глубина нарисована.
+    // Уровень 0 - степень двойки не меньше половины буфера глубины, поэтому тексел
+    // уровня k покрывает ровно 2^(k+1) пикселей по каждой оси; тексели за краем
+    // буфера глубины равны 0 и не влияют на максимум.
+    // Изображение всегда в VK_IMAGE_LAYOUT_GENERAL.
+    class hiz_pyramid {
+    public:
+        static constexpr uint32 WORKGROUP_SIZE = 8;
+
+        explicit hiz_pyramid(std::shared_ptr<vulkan_context> context);
+        ~hiz_pyramid();
+
+        // Запретить копирование
+        hiz_pyramid(const hiz_pyramid&) = delete;
+        hiz_pyramid& operator=(const hiz_pyramid&) = delete;
+
+        // Пересоздает пирамиду под буфер глубины; depth_view - вид только глубины.
+        // GPU не должен использовать пирамиду (вызывается после wait_idle)
+        void resize(VkImageView depth_view, VkExtent2D depth_extent);
+
+        // До первого использования после resize: переводит изображение в GENERAL
+        void prepare(VkCommandBuffer command_buffer);
+
+        // После render pass: буфер глубины в DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+        // view_projection - матрица, с которой нарисована глубина
+        void build(VkCommandBuffer command_buffer, const mat4f& view_projection);
+
+        // Пирамида построена после последнего resize и не устарела
+        bool is_built() const { return built_; }
+        // Кадр нарисован без построения: пирамида больше не соответствует глубине
+        void invalidate() { built_ = false; }
+        const mat4f& get_view_projection() const { return view_projection_; }
+
+        VkImageView get_view() const { return view_; }
+        VkSampler get_sampler() const { return sampler_; }
+        VkExtent2D get_depth_extent() const { return depth_extent_; }
+        uint32 get_level_count() const { return static_cast<uint32>(level_views_.size()); }
+
+    private:
+        void create_pipeline();
+        void destroy_image();
+
+        std::shared_ptr<vulkan_context> context_;
+        std::unique_ptr<shader> shader_;
+        VkDescriptorSetLayout set_layout_;
+        VkPipelineLayout pipeline_layout_;
+        VkPipeline pipeline_;
+        VkSampler sampler_;
+
+        VkImage image_;
+        gpu_allocation allocation_;
+        VkImageView view_;                       // Все уровни - для отсечения
+        std::vector<VkImageView> level_views_;   // По уровню - для записи и чтения при построении
+        std::vector<VkExtent2D> level_extents_;
+        VkDescriptorPool descriptor_pool_;
+        std::vector<VkDescriptorSet> level_sets_; // Уровень i: источник (глубина или уровень i-1) и приемник
+
+        VkExtent2D depth_extent_{};
+        mat4f view_projection_;
+        bool initialized_ = false; // prepare уже записан
+        bool built_ = false;
+    };
+}
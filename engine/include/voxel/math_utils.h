@@ -62,11 +62,25 @@ namespace math {
     mat4f scale_matrix(const vec3f& scale);
     mat4f transform_matrix(const vec3f& position, const vec3f& rotation, const vec3f& scale);
     
+    // Трансформация точки матрицей (вектор-строка, перенос в строке 3)
+    inline vec3f transform_point(const mat4f& m, const vec3f& p) {
+        return vec3f(
+            p.x * m(0, 0) + p.y * m(1, 0) + p.z * m(2, 0) + m(3, 0),
+            p.x * m(0, 1) + p.y * m(1, 1) + p.z * m(2, 1) + m(3, 1),
+            p.x * m(0, 2) + p.y * m(1, 2) + p.z * m(2, 2) + m(3, 2)
+        );
+    }
+    
     // Утилиты для матриц
     mat4f identity_matrix();
     mat4f transpose_matrix(const mat4f& matrix);
     mat4f inverse_matrix(const mat4f& matrix);
     
+    // Матрица нормалей: обратная транспонированная к блоку 3x3 модели (работает и при
+    // неравномерном масштабе), строка 3 и столбец 3 - как у единичной. Строки 0-2 лежат
+    // в памяти как столбцы mat3 шейдера, выровненные до vec4
+    mat4f normal_matrix(const mat4f& model);
+    
     // Дополнительные математические функции
     inline float clamp(float value, float min_val, float max_val) {
         if (value < min_val) return min_val;
@@ -1,68 +1,164 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <array>
 #include <vulkan/vulkan.h>
 
 #include <voxel/types.h>
 #include <voxel/model.h>
 #include <voxel/buffer.h>
+#include <voxel/mesh_arena.h>
 
 namespace voxel {
     class vulkan_context;
+    class upload_queue;
 
+    // Упакованная вершина воксельного меша (8 байт):
+    // data0 - координаты x, y, z по 10 бит (0..1023),
+    // data1 - цвет RGB (24 бита) и направление грани (3 бита: 0=+X, 1=-X, 2=+Y, 3=-Y, 4=+Z, 5=-Z)
     struct vertex {
-        vec3f position;
-        vec3f normal;
-        uint32 color;
+        static constexpr int POSITION_BITS = 10;
+        static constexpr int MAX_POSITION = (1 << POSITION_BITS) - 1;
 
-        vertex() : position(), normal(), color(0) {}
-        vertex(const vec3f& pos, const vec3f& norm, uint32 col) 
-            : position(pos), normal(norm), color(col) {}
+        uint32 data0;
+        uint32 data1;
+
+        vertex() : data0(0), data1(0) {}
+        vertex(int x, int y, int z, int face_direction, uint32 color)
+            : data0(static_cast<uint32>(x) |
+                    (static_cast<uint32>(y) << POSITION_BITS) |
+                    (static_cast<uint32>(z) << (2 * POSITION_BITS))),
+              data1((color >> 8) | (static_cast<uint32>(face_direction) << 24)) {}
+        vertex(const vec3f& pos, int face_direction, uint32 color)
+            : vertex(static_cast<int>(pos.x), static_cast<int>(pos.y), static_cast<int>(pos.z), face_direction, color) {}
+
+        // Распаковка (для CPU-кода и отладки)
+        vec3f position() const {
+            return vec3f(
+                static_cast<float>(data0 & MAX_POSITION),
+                static_cast<float>((data0 >> POSITION_BITS) & MAX_POSITION),
+                static_cast<float>((data0 >> (2 * POSITION_BITS)) & MAX_POSITION)
+            );
+        }
+        int face_direction() const { return static_cast<int>((data1 >> 24) & 7); }
+        uint32 color() const { return (data1 << 8) | 0xFF; }
 
         static std::vector<VkVertexInputBindingDescription> get_binding_descriptions();
         static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions();
     };
 
+    // Упакованный квад для вытягивания вершин в шейдере (12 байт):
+    // data0 - минимальный угол x, y, z по 10 бит,
+    // data1 - размеры по x, y, z по 10 бит (по оси грани - 1),
+    // data2 - цвет RGB (24 бита) и направление грани (как в vertex)
+    struct quad_record {
+        uint32 data0;
+        uint32 data1;
+        uint32 data2;
+
+        quad_record() : data0(0), data1(0), data2(0) {}
+        quad_record(const vec3f& min_pos, const vec3f& max_pos, int face_direction, uint32 color)
+            : data0(pack(static_cast<int>(min_pos.x), static_cast<int>(min_pos.y), static_cast<int>(min_pos.z))),
+              data1(pack(static_cast<int>(max_pos.x - min_pos.x), static_cast<int>(max_pos.y - min_pos.y),
+                         static_cast<int>(max_pos.z - min_pos.z))),
+              data2((color >> 8) | (static_cast<uint32>(face_direction) << 24)) {}
+
+        int face_direction() const { return static_cast<int>((data2 >> 24) & 7); }
+        uint32 color() const { return (data2 << 8) | 0xFF; }
+
+    private:
+        static uint32 pack(int x, int y, int z) {
+            return static_cast<uint32>(x) |
+                   (static_cast<uint32>(y) << vertex::POSITION_BITS) |
+                   (static_cast<uint32>(z) << (2 * vertex::POSITION_BITS));
+        }
+    };
+
+    // Формат данных меша
+    enum class mesh_format {
+        indexed, // 4 вершины и 6 индексов на квад
+        quads    // одна запись quad_record на квад, вершины строит шейдер по gl_VertexIndex
+    };
+
     // Структура для хранения данных меша без Vulkan буферов
     struct mesh_data {
         std::vector<vertex> vertices;
         std::vector<uint32> indices;
+        std::vector<quad_record> quads;
         
         mesh_data() = default;
         mesh_data(std::vector<vertex> v, std::vector<uint32> i) 
             : vertices(std::move(v)), indices(std::move(i)) {}
+        explicit mesh_data(std::vector<quad_record> q)
+            : quads(std::move(q)) {}
+
+        size_t get_byte_size() const {
+            return vertices.size() * sizeof(vertex) + indices.size() * sizeof(uint32) + quads.size() * sizeof(quad_record);
+        }
     };
 
     class mesh {
     public:
         mesh(std::shared_ptr<vulkan_context> context);
-        ~mesh() = default;
+        ~mesh();
 
         // Запретить копирование
         mesh(const mesh&) = delete;
         mesh& operator=(const mesh&) = delete;
 
         // Разрешить перемещение
-        mesh(mesh&&) = default;
+        mesh(mesh&& other) noexcept;
         mesh& operator=(mesh&&) = delete;
 
         void set_vertices(const std::vector<vertex>& vertices);
         void set_indices(const std::vector<uint32>& indices);
+        // Квады в storage buffer (binding 0 набора QUAD_SET) - без вершин и индексов
+        void set_quads(const std::vector<quad_record>& quads);
         void set_mesh_data(const mesh_data& data);
+        // Данные в DEVICE_LOCAL буферах; копирование записывается в пакет uploads
+        // и выполняется после uploads.flush()
+        void set_mesh_data(const mesh_data& data, upload_queue& uploads);
+        // Вершины и индексы - в общей арене; если места нет или меш из квадов,
+        // данные идут в собственные буферы, как в перегрузке выше
+        void set_mesh_data(const mesh_data& data, std::shared_ptr<mesh_arena> arena, upload_queue& uploads);
 
         void bind(VkCommandBuffer command_buffer);
         void draw(VkCommandBuffer command_buffer);
-        void draw_indexed(VkCommandBuffer command_buffer);
+        void draw_indexed(VkCommandBuffer command_buffer, uint32 instance_count = 1, uint32 first_instance = 0);
 
+        // Для pipeline с вытягиванием вершин: 6 вершин на квад, без index buffer
+        void bind_quads(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout);
+        void draw_quads(VkCommandBuffer command_buffer);
+
+        mesh_format get_format() const { return quad_count_ > 0 ? mesh_format::quads : mesh_format::indexed; }
         size_t get_vertex_count() const { return vertex_count_; }
         size_t get_index_count() const { return index_count_; }
+        size_t get_quad_count() const { return quad_count_; }
+
+        // Меш в общей арене рисуется с привязанными буферами арены
+        bool is_in_arena() const { return arena_ != nullptr; }
+        const mesh_arena* get_arena() const { return arena_.get(); }
+        const mesh_arena_range& get_arena_range() const { return arena_range_; }
+
+        // Номер набора дескрипторов с буфером квадов в layout pipeline
+        static constexpr uint32 QUAD_SET = 1;
 
     private:
+        void create_quad_descriptor();
+        void release_quad_descriptor();
+
         std::shared_ptr<vulkan_context> context_;
         std::unique_ptr<vertex_buffer> vertex_buffer_;
         std::unique_ptr<index_buffer> index_buffer_;
+        std::unique_ptr<storage_buffer> quad_buffer_;
+        VkDescriptorPool quad_descriptor_pool_;
+        VkDescriptorSet quad_descriptor_set_;
+        std::shared_ptr<mesh_arena> arena_;
+        mesh_arena_range arena_range_;
         size_t vertex_count_;
         size_t index_count_;
+        size_t quad_count_;
     };
 
     // Простой генератор мешей из воксельных моделей
@@ -89,6 +185,8 @@ namespace voxel {
         static mesh_data generate_mesh_data(const std::shared_ptr<model>& model);
         
     private:
+        friend class binary_mesh_generator;
+
         static void generate_face_quads(
             std::vector<vertex>& vertices,
             std::vector<uint32>& indices,
@@ -105,4 +203,83 @@ namespace voxel {
         );
         static bool is_face_visible(const std::shared_ptr<model>& model, int x, int y, int z, int face_direction);
     };
+
+    // Занятость соседних слоев за гранями модели - для отсечения граней на стыках
+    // соседних моделей (чанков). Плоскость грани хранит биты в координатах (u, v)
+    // её оси: X - (z, y), Y - (x, z), Z - (x, y). Грань без плоскости граничит с пустотой.
+    class mesh_borders {
+    public:
+        // Копирует слой neighbor, прилегающий к грани face_direction модели target
+        void set_face(const model& target, int face_direction, const model& neighbor);
+        void clear_face(int face_direction) { planes_[face_direction].clear(); }
+
+        // Хэш всех слоев (для ключа кэша мешей)
+        uint64 content_hash() const;
+
+        bool is_solid(int face_direction, int u, int v) const {
+            const auto& plane = planes_[face_direction];
+            if (plane.empty()) return false;
+            const size_t bit = static_cast<size_t>(v) * widths_[face_direction] + u;
+            return (plane[bit >> 6] >> (bit & 63)) & 1;
+        }
+
+    private:
+        std::array<std::vector<uint64>, 6> planes_;
+        std::array<int, 6> widths_{};
+    };
+
+    // Бинарный жадный генератор: колонки модели упаковываются в 64-битные
+    // маски занятости, видимые грани отсекаются сдвигами и AND, а квады
+    // объединяются сканированием битов по маскам граней каждого цвета.
+    // Квады не объединяются через границы 64-вокселных полос.
+    class binary_mesh_generator {
+    public:
+        static mesh generate_from_model(std::shared_ptr<vulkan_context> context, const std::shared_ptr<model>& model);
+        // cancelled - флаг отмены; при его установке генерация прерывается
+        // и возвращаются пустые данные
+        static mesh_data generate_mesh_data(
+            const std::shared_ptr<model>& model,
+            const std::atomic<bool>* cancelled = nullptr
+        );
+        // То же с учетом соседей: грани, закрытые слоями borders, не создаются
+        static mesh_data generate_mesh_data(
+            const std::shared_ptr<model>& model,
+            const mesh_borders& borders,
+            const std::atomic<bool>* cancelled = nullptr
+        );
+        // Данные в формате format; borders может быть nullptr
+        static mesh_data generate_mesh_data(
+            const std::shared_ptr<model>& model,
+            const mesh_borders* borders,
+            mesh_format format,
+            const std::atomic<bool>* cancelled = nullptr
+        );
+
+    private:
+        static mesh_data generate(
+            const std::shared_ptr<model>& model,
+            const mesh_borders* borders,
+            mesh_format format,
+            const std::atomic<bool>* cancelled
+        );
+        static void generate_axis_quads(
+            mesh_data& data,
+            mesh_format format,
+            const model& model,
+            const std::vector<uint64>& columns,
+            int axis,
+            const mesh_borders* borders,
+            const std::atomic<bool>* cancelled
+        );
+        static void merge_plane_quads(
+            mesh_data& data,
+            mesh_format format,
+            uint64* plane,
+            int plane_width,
+            int plane_height,
+            int layer,
+            int face_direction,
+            uint32 color
+        );
+    };
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <map>
+#include <vulkan/vulkan.h>
+
+#include <voxel/types.h>
+#include <voxel/buffer.h>
+
+namespace voxel {
+    class vulkan_context;
+
+    // Участок арены, занятый одним мешем (в вершинах и индексах)
+    struct mesh_arena_range {
+        uint32 first_vertex = 0;
+        uint32 vertex_count = 0;
+        uint32 first_index = 0;
+        uint32 index_count = 0;
+
+        explicit operator bool() const { return index_count > 0; }
+    };
+
+    // Общие DEVICE_LOCAL vertex и index буферы для мешей мира: все меши
+    // рисуются с одной привязкой буферов, что позволяет отрисовать их одним
+    // vkCmdDrawIndexedIndirect. Индексы меша остаются локальными - смещение
+    // вершин задается vertexOffset команды отрисовки.
+    // Освобожденные участки переиспользуются после завершения GPU кадров,
+    // которые могли их читать, чтобы не перезаписать данные кадров в полете.
+    // Используется из одного (основного) потока.
+    class mesh_arena {
+    public:
+        static constexpr uint32 DEFAULT_VERTEX_CAPACITY = 8u * 1024 * 1024;  // 64 МБ упакованных вершин
+        static constexpr uint32 DEFAULT_INDEX_CAPACITY = 16u * 1024 * 1024;  // 64 МБ индексов
+
+        mesh_arena(
+            std::shared_ptr<vulkan_context> context,
+            uint32 vertex_capacity = DEFAULT_VERTEX_CAPACITY,
+            uint32 index_capacity = DEFAULT_INDEX_CAPACITY
+        );
+
+        // Запретить копирование
+        mesh_arena(const mesh_arena&) = delete;
+        mesh_arena& operator=(const mesh_arena&) = delete;
+
+        // false - в арене нет непрерывного места (меш остается в своих буферах)
+        bool allocate(uint32 vertex_count, uint32 index_count, mesh_arena_range& range);
+        // Участок вернется в арену после завершения текущего кадра рендерера
+        void release(const mesh_arena_range& range);
+        // frame - записываемый кадр рендерера, completed_frame - все кадры до него
+        // включительно завершены GPU. Вызывается раз в кадр
+        void advance_frame(uint64 frame, uint64 completed_frame);
+
+        void bind(VkCommandBuffer command_buffer) const;
+
+        vertex_buffer& get_vertex_buffer() { return *vertex_buffer_; }
+        index_buffer& get_index_buffer() { return *index_buffer_; }
+        uint32 get_vertex_capacity() const { return vertices_.capacity; }
+        uint32 get_index_capacity() const { return indices_.capacity; }
+        uint32 get_used_vertices() const { return vertices_.used; }
+        uint32 get_used_indices() const { return indices_.used; }
+
+    private:
+        // Список свободных промежутков first-fit со слиянием соседей
+        struct range_list {
+            uint32 capacity = 0;
+            uint32 used = 0;
+            std::map<uint32, uint32> free_ranges; // offset -> count
+
+            void reset(uint32 new_capacity);
+            bool allocate(uint32 count, uint32& offset);
+            void release(uint32 offset, uint32 count);
+        };
+
+        struct retired_range {
+            mesh_arena_range range;
+            uint64 frame;
+        };
+
+        std::shared_ptr<vulkan_context> context_;
+        std::unique_ptr<vertex_buffer> vertex_buffer_;
+        std::unique_ptr<index_buffer> index_buffer_;
+        range_list vertices_;
+        range_list indices_;
+        std::vector<retired_range> retired_;
+        uint64 frame_ = 0;
+    };
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include <voxel/types.h>
+#include <voxel/model.h>
+#include <voxel/mesh.h>
+
+namespace voxel {
+    // Ключ меша: содержимое и размер модели, слои соседей и формат
+    struct mesh_cache_key {
+        model_hash content;
+        uint64 borders = 0;  // Хэш mesh_borders (0 - без соседей)
+        int width = 0;
+        int height = 0;
+        int depth = 0;
+        mesh_format format = mesh_format::indexed;
+
+        bool operator==(const mesh_cache_key& other) const {
+            return content == other.content && borders == other.borders &&
+                   width == other.width && height == other.height && depth == other.depth &&
+                   format == other.format;
+        }
+    };
+
+    struct mesh_cache_key_hash {
+        size_t operator()(const mesh_cache_key& key) const {
+            return static_cast<size_t>(key.content.lo ^ (key.borders * 0x9e3779b97f4a7c15ull) ^ static_cast<uint64>(key.format));
+        }
+    };
+
+    // Кэш GPU мешей по содержимому моделей: одинаковые модели (пропсы,
+    // однородные чанки с одинаковыми соседями) мешатся и загружаются один раз.
+    // Вытеснение LRU по суммарному объему данных мешей и числу записей;
+    // вытесненный меш живет, пока его используют объекты.
+    class mesh_cache {
+    public:
+        static constexpr size_t DEFAULT_MEMORY_LIMIT = 64ull * 1024 * 1024;
+
+        // memory_limit = 0 - кэш выключен; entry_limit = 0 - без ограничения числа записей
+        explicit mesh_cache(size_t memory_limit = DEFAULT_MEMORY_LIMIT, size_t entry_limit = 0);
+
+        // borders может быть nullptr
+        static mesh_cache_key make_key(const model& model, const mesh_borders* borders, mesh_format format);
+
+        // nullptr - промах; попадание делает запись самой свежей
+        std::shared_ptr<mesh> find(const mesh_cache_key& key);
+        // byte_size - объем данных меша (mesh_data::get_byte_size)
+        void insert(const mesh_cache_key& key, std::shared_ptr<mesh> pmesh, size_t byte_size);
+        void clear();
+
+        void set_limits(size_t memory_limit, size_t entry_limit = 0);
+        bool is_enabled() const { return memory_limit_ > 0; }
+        size_t get_memory_limit() const { return memory_limit_; }
+        size_t get_entry_limit() const { return entry_limit_; }
+        size_t get_memory_usage() const { return memory_usage_; }
+        size_t get_entry_count() const { return entries_.size(); }
+        uint64 get_hit_count() const { return hits_; }
+        uint64 get_miss_count() const { return misses_; }
+
+    private:
+        struct entry {
+            mesh_cache_key key;
+            std::shared_ptr<mesh> pmesh;
+            size_t cost;
+        };
+
+        void evict();
+
+        std::list<entry> lru_; // Начало - самые свежие
+        std::unordered_map<mesh_cache_key, std::list<entry>::iterator, mesh_cache_key_hash> entries_;
+        size_t memory_limit_;
+        size_t entry_limit_;
+        size_t memory_usage_ = 0;
+        uint64 hits_ = 0;
+        uint64 misses_ = 0;
+    };
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+#include <voxel/types.h>
+#include <voxel/model.h>
+#include <voxel/mesh.h>
+
+namespace voxel {
+    // Задача генерации меша
+    struct mesh_generation_task {
+        object_id id;
+        std::shared_ptr<model> pmodel;
+        std::promise<mesh_data> promise;
+        float priority = 0.0f;        // Чем больше, тем раньше задача будет выполнена
+        uint64 sequence = 0;          // Порядок поступления для равных приоритетов
+        std::shared_ptr<std::atomic<bool>> cancelled; // Токен отмены (задача устарела)
+        std::shared_ptr<const mesh_borders> borders;  // Слои соседних моделей (nullptr - соседей нет)
+        mesh_format format = mesh_format::indexed;    // Формат результата
+        
+        mesh_generation_task(object_id id, std::shared_ptr<model> pmodel)
+            : id(id), pmodel(pmodel), cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+        bool is_cancelled() const { return cancelled && cancelled->load(std::memory_order_relaxed); }
+    };
+
+    // Пул потоков генерации мешей.
+    // У каждого рабочего потока своя очередь с приоритетами (задачи раскладываются
+    // по кругу). Свободный поток берет вершину своей очереди и крадет из чужой,
+    // только если её вершина приоритетнее; очереди блокируются по одной.
+    class mesh_worker_pool {
+    public:
+        using task_ptr = std::unique_ptr<mesh_generation_task>;
+
+        // thread_count = 0 - по числу аппаратных потоков
+        explicit mesh_worker_pool(size_t thread_count = 0);
+        ~mesh_worker_pool();
+
+        // Запретить копирование и перемещение
+        mesh_worker_pool(const mesh_worker_pool&) = delete;
+        mesh_worker_pool& operator=(const mesh_worker_pool&) = delete;
+
+        void submit(task_ptr task);
+
+        // Пересчитывает приоритеты всех ожидающих задач, отбрасывает отмененные
+        // и перестраивает очереди.
+        // Функция вызывается под блокировкой очереди и не должна обращаться к пулу.
+        void reprioritize(const std::function<float(const mesh_generation_task&)>& priority_fn);
+
+        // Перезапускает потоки; незавершенные задачи перераспределяются
+        void set_thread_count(size_t thread_count);
+        size_t get_thread_count() const { return threads_.size(); }
+
+        // Глубина очереди каждого рабочего потока
+        std::vector<size_t> get_queue_depths() const;
+        size_t get_pending_count() const { return pending_.load(); }
+
+        static size_t default_thread_count();
+
+    private:
+        // Порядок задачи: приоритет и номер поступления
+        struct task_key {
+            float priority;
+            uint64 sequence;
+        };
+
+        // Очередь рабочего потока - двоичная куча по приоритету
+        struct worker_queue {
+            mutable std::mutex mutex;
+            std::vector<task_ptr> tasks;
+
+            void push(task_ptr task);
+            task_ptr pop();
+            // Порядок вершины (под блокировкой очереди); false - очередь пуста
+            bool peek(task_key& key) const;
+        };
+
+        static bool key_less(const task_key& a, const task_key& b);
+        static bool task_less(const task_ptr& a, const task_ptr& b);
+
+        void start(size_t thread_count);
+        std::vector<task_ptr> stop();
+        void worker_function(size_t index);
+        task_ptr pop_task(size_t index);
+        static void run_task(mesh_generation_task& task);
+
+        std::vector<std::unique_ptr<worker_queue>> queues_;
+        std::vector<std::thread> threads_;
+
+        std::mutex wake_mutex_;
+        std::condition_variable wake_cv_;
+        std::atomic<size_t> pending_{0};
+        size_t next_queue_ = 0;
+        uint64 next_sequence_ = 0;
+        bool running_ = false;
+    };
+}
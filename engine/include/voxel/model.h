@@ -3,16 +3,48 @@
 
 #include <voxel/types.h>
 #include <voxel/voxel.h>
+#include <voxel/palette_storage.h>
+#include <voxel/brick_storage.h>
 
 namespace voxel {
+    // Способ хранения вокселей модели
+    enum class model_storage {
+        dense,   // 32-битный цвет на каждую ячейку
+        palette, // индексы в палитре модели переменной ширины (1-16 бит)
+        sparse   // кирпичи 8x8x8, однородные кирпичи без памяти под ячейки
+    };
+
+    // Хэш содержимого модели - две независимые 64-битные половины
+    struct model_hash {
+        uint64 lo = 0;
+        uint64 hi = 0;
+
+        bool operator==(const model_hash& other) const { return lo == other.lo && hi == other.hi; }
+        bool operator!=(const model_hash& other) const { return !(*this == other); }
+    };
+
     class model {
     public:
-        model(int width, int height, int depth);
+        model(int width, int height, int depth, model_storage storage = model_storage::dense);
         
         // Методы для работы с voxel объектами
         void set_voxel(int x, int y, int z, const voxel& voxel);
         voxel get_voxel(int x, int y, int z) const;
         
+        // Доступ без проверки границ (для генераторов мешей)
+        voxel get_voxel_unchecked(int x, int y, int z) const {
+            switch (storage_) {
+                case model_storage::dense: return voxels_[index(x, y, z)];
+                case model_storage::palette: return palette_.get(index(x, y, z));
+                default: return bricks_.get(x, y, z);
+            }
+        }
+        
+        // Кирпичи разреженного хранения (для быстрого пропуска пустых областей)
+        const brick_storage* get_bricks() const {
+            return storage_ == model_storage::sparse ? &bricks_ : nullptr;
+        }
+        
         // Проверка существования воксела
         bool has_voxel(int x, int y, int z) const;
         bool is_empty(int x, int y, int z) const;
@@ -26,9 +58,34 @@ namespace voxel {
         void clear();
         void fill(const voxel& voxel);
         
+        // Способ хранения (с конвертацией данных)
+        model_storage get_storage() const { return storage_; }
+        void set_storage(model_storage storage);
+        
+        // Освобождение памяти кирпичей, ставших однородными (sparse)
+        void optimize_storage();
+        
+        // Объем памяти, занимаемый вокселями
+        size_t memory_usage() const;
+        
+        // Хэш содержимого, обновляемый при каждой записи: модели одного размера
+        // с равными вокселями имеют равный хэш независимо от способа хранения
+        const model_hash& content_hash() const { return hash_; }
+        
     private:
+        void update_hash(int index, uint32 old_color, uint32 new_color);
+
+        model_hash hash_;
+        model_hash fill_weight_;  // Сумма весов всех ячеек (вычисляется при первом fill)
+        bool fill_weight_ready_ = false;
+
         int width_, height_, depth_;
+        model_storage storage_;
         std::vector<voxel> voxels_;
-        int index(int x, int y, int z) const;
+        palette_storage palette_;
+        brick_storage bricks_;
+        int index(int x, int y, int z) const {
+            return x + y * width_ + z * width_ * height_;
+        }
     };
-} 
\ No newline at end of file
+}
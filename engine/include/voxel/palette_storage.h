@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+
+#include <voxel/types.h>
+#include <voxel/voxel.h>
+
+namespace voxel {
+    // Палитровое хранилище вокселей: каждая ячейка хранит индекс в палитре
+    // модели шириной 1/2/4/8/16 бит. При росте палитры данные автоматически
+    // переупаковываются в более широкий формат.
+    class palette_storage {
+    public:
+        static constexpr uint32 MAX_BITS = 16;
+
+        palette_storage() = default;
+        palette_storage(size_t size, const voxel& value = voxel());
+
+        voxel get(size_t index) const {
+            const uint64 word = data_[index >> entries_shift_];
+            const uint32 shift = static_cast<uint32>(index & entries_mask_) << bits_shift_;
+            return palette_[(word >> shift) & value_mask_];
+        }
+
+        // Возвращает false, если цвет не помещается в 16-битную палитру
+        bool set(size_t index, const voxel& value);
+
+        void fill(const voxel& value);
+
+        size_t size() const { return size_; }
+        uint32 bits_per_voxel() const { return 1u << bits_shift_; }
+        const std::vector<voxel>& palette() const { return palette_; }
+        size_t memory_usage() const;
+
+    private:
+        void set_bits(uint32 bits_shift);
+        void repack(uint32 bits_shift);
+
+        uint32 read_index(size_t index) const;
+        void write_index(size_t index, uint32 value);
+
+        size_t size_ = 0;
+        std::vector<uint64> data_;
+        std::vector<voxel> palette_;                       // palette_[0] - пустой воксел
+        std::unordered_map<uint32, uint32> palette_lookup_; // цвет -> индекс в палитре
+
+        uint32 bits_shift_ = 0;    // log2(бит на воксел)
+        uint32 entries_shift_ = 6; // log2(вокселей в 64-битном слове)
+        uint64 entries_mask_ = 63;
+        uint64 value_mask_ = 1;
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <filesystem>
+#include <vulkan/vulkan.h>
+
+#include <voxel/types.h>
+
+namespace voxel {
+    // VkPipelineCache, сохраняемый между запусками. Файл - заголовок (магия, версия,
+    // размер и контрольная сумма данных) и данные vkGetPipelineCacheData. Данные
+    // принимаются, только если их заголовок совпадает с устройством: vendorID, deviceID
+    // и pipelineCacheUUID (меняется с версией драйвера). Иначе кэш начинается пустым.
+    // Сам VkPipelineCache потокобезопасен, save - нет.
+    class pipeline_cache {
+    public:
+        static constexpr const char* DIRECTORY_NAME = "voxelworld";
+        static constexpr const char* FILE_NAME = "pipelines.bin";
+
+        pipeline_cache(VkDevice device, VkPhysicalDevice physical_device, std::filesystem::path path = default_path());
+        // Сохраняет кэш
+        ~pipeline_cache();
+
+        // Запретить копирование
+        pipeline_cache(const pipeline_cache&) = delete;
+        pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+        VkPipelineCache get_cache() const { return cache_; }
+        const std::filesystem::path& get_path() const { return path_; }
+        // Кэш создан из данных файла
+        bool is_loaded() const { return loaded_; }
+
+        // Записывает кэш во временный файл и заменяет им прежний; false - ошибка записи
+        bool save() const;
+
+        // Файл кэша пользователя, не зависящий от текущего каталога:
+        // $XDG_CACHE_HOME или ~/.cache на Linux, %LOCALAPPDATA% на Windows,
+        // иначе каталог исполняемого файла (иначе - текущий)
+        static std::filesystem::path default_path();
+
+    private:
+        static constexpr uint32 MAGIC = 0x43505856; // "VXPC"
+        static constexpr uint32 VERSION = 1;
+
+        struct file_header {
+            uint32 magic;
+            uint32 version;
+            uint64 data_size;
+            uint64 checksum;
+        };
+
+        std::vector<uint8> load_data() const;
+        bool is_compatible(const std::vector<uint8>& data) const;
+        static uint64 checksum(const uint8* data, size_t size);
+
+        VkDevice device_;
+        VkPhysicalDeviceProperties properties_{};
+        std::filesystem::path path_;
+        VkPipelineCache cache_ = VK_NULL_HANDLE;
+        bool loaded_ = false;
+    };
+}
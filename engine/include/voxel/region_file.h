@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <shared_mutex>
+#include <functional>
+
+#include <voxel/types.h>
+#include <voxel/chunk.h>
+
+namespace voxel {
+    // Файл региона: REGION_SIZE^3 чанков в одном файле.
+    // В начале файла - заголовок и таблица смещений, данные чанков лежат
+    // непрерывными отрезками секторов по 4 КиБ. Чтение идет через отображение
+    // файла в память: данные чанка разбираются прямо со страниц файла.
+    class region_file {
+    public:
+        static constexpr int REGION_SHIFT = 3;
+        static constexpr int REGION_SIZE = 1 << REGION_SHIFT;
+        static constexpr int REGION_MASK = REGION_SIZE - 1;
+        static constexpr int REGION_CHUNKS = REGION_SIZE * REGION_SIZE * REGION_SIZE;
+        static constexpr uint32 SECTOR_SIZE = 4096;
+
+        // Открывает существующий файл или создает новый
+        explicit region_file(const std::filesystem::path& path);
+        ~region_file();
+
+        // Запретить копирование
+        region_file(const region_file&) = delete;
+        region_file& operator=(const region_file&) = delete;
+
+        // Передает reader данные чанка; false - чанка в файле нет.
+        // Данные действительны только внутри reader. Потокобезопасно.
+        bool read_chunk(int index, const std::function<void(const uint8* data, size_t size)>& reader) const;
+
+        // Записывает пачку чанков (пустые данные удаляют чанк) и обновляет таблицу
+        void write_chunks(const std::vector<std::pair<int, std::vector<uint8>>>& chunks);
+
+        bool has_chunk(int index) const;
+
+        // Регион чанка и индекс чанка внутри региона
+        static chunk_coord region_of(const chunk_coord& coord) {
+            return chunk_coord(coord.x >> REGION_SHIFT, coord.y >> REGION_SHIFT, coord.z >> REGION_SHIFT);
+        }
+        static int chunk_index(const chunk_coord& coord) {
+            return (coord.x & REGION_MASK) |
+                   ((coord.y & REGION_MASK) << REGION_SHIFT) |
+                   ((coord.z & REGION_MASK) << (2 * REGION_SHIFT));
+        }
+
+    private:
+        struct table_entry {
+            uint32 sector = 0; // Первый сектор данных
+            uint32 size = 0;   // Размер данных в байтах (0 - чанка нет)
+        };
+
+        static constexpr uint32 MAGIC = 0x47525856; // "VXRG"
+        static constexpr uint32 VERSION = 1;
+        static constexpr uint32 HEADER_SIZE = 16;   // magic, version, размер региона, резерв
+        static constexpr uint32 DATA_SECTOR =
+            (HEADER_SIZE + REGION_CHUNKS * sizeof(table_entry) + SECTOR_SIZE - 1) / SECTOR_SIZE;
+
+        static uint32 sector_count(uint32 size) { return (size + SECTOR_SIZE - 1) / SECTOR_SIZE; }
+
+        void create();
+        void read_table();
+        void map();
+        void unmap();
+        uint32 allocate_sectors(uint32 count);
+        void mark_sectors(uint32 sector, uint32 count, bool used);
+
+        std::filesystem::path path_;
+        std::fstream file_;
+        std::array<table_entry, REGION_CHUNKS> table_;
+        std::vector<bool> used_sectors_;
+
+        // Отображение файла: читатели держат разделяемую блокировку, запись - исключительную
+        mutable std::shared_mutex mutex_;
+        const uint8* data_ = nullptr;
+        size_t size_ = 0;
+    };
+}
@@ -2,8 +2,12 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 #include <voxel/types.h>
+#include <voxel/frustum.h>
+#include <voxel/gpu_allocator.h>
 
 namespace voxel {
     class vulkan_context;
@@ -12,7 +16,13 @@ namespace voxel {
     class mesh;
     class shader;
     class uniform_buffer;
+    class storage_buffer;
+    class indirect_buffer;
     class world;
+    class mesh_arena;
+    class gpu_culler;
+    class hiz_pyramid;
+    class command_recorder;
 
     struct uniform_buffer_object {
         alignas(16) float view[16];
@@ -22,9 +32,22 @@ namespace voxel {
         alignas(16) vec3f light_color;
     };
 
+    // Матрица нормалей - mat3, столбцы выровнены до vec4 (строки 0-2 transform::get_normal_matrix)
     struct push_constant_data {
         alignas(16) float model[16];
+        alignas(16) float normal[12];
     };
+    // Блок PushConstants voxel.vert и voxel_quad.vert: mat4 (64) + mat3 (3 x vec4 = 48).
+    // 128 байт - минимальный maxPushConstantsSize, который гарантирует Vulkan
+    static_assert(sizeof(push_constant_data) == 112, "push_constant_data must match PushConstants {mat4; mat3}");
+    static_assert(sizeof(push_constant_data) <= 128, "push constants exceed the guaranteed maxPushConstantsSize");
+
+    // Элемент буфера матриц экземпляров (storage buffer, std430 {mat4; mat3})
+    struct object_transform_data {
+        alignas(16) float model[16];
+        alignas(16) float normal[12];
+    };
+    static_assert(sizeof(object_transform_data) == 112, "object_transform_data must match std430 {mat4; mat3}");
 
     class renderer {
     public:
@@ -48,12 +71,47 @@ namespace voxel {
         // Обработка изменения размера окна
         void handle_resize();
 
+        // Отсечение объектов мира пирамидой видимости камеры (включено по умолчанию)
+        void set_frustum_culling_enabled(bool enabled) { frustum_culling_ = enabled; }
+        bool is_frustum_culling_enabled() const { return frustum_culling_; }
+        size_t get_culled_object_count() const { return culled_object_count_; } // За последний render_world, без отсеченных на GPU
+
+        // Меши арены мира отсекаются compute шейдером и рисуются vkCmdDrawIndexedIndirectCountKHR
+        // (включено по умолчанию, если устройство поддерживает VK_KHR_draw_indirect_count и drawIndirectFirstInstance)
+        void set_gpu_culling_enabled(bool enabled) { gpu_culling_ = enabled; }
+        bool is_gpu_culling_enabled() const { return gpu_culling_; }
+        bool is_gpu_culling_available() const { return gpu_culler_ != nullptr; }
+
+        // Меши, отсекаемые на GPU, проверяются и перекрытием - по пирамиде глубины
+        // прошлого кадра (включено по умолчанию; без отсечения на GPU не действует)
+        void set_occlusion_culling_enabled(bool enabled) { occlusion_culling_ = enabled; }
+        bool is_occlusion_culling_enabled() const { return occlusion_culling_; }
+
+        // Потоки записи вторичных command buffer: если групп экземпляров и объектов,
+        // рисуемых по одному, не меньше PARALLEL_RECORDING_MIN_DRAWS, они записываются
+        // параллельно участками.
+        // 0 - все на основном потоке. По умолчанию - command_recorder::default_thread_count()
+        void set_recording_thread_count(size_t thread_count);
+        size_t get_recording_thread_count() const;
+
     private:
-        void create_swapchain();
+        void create_swapchain(VkSwapchainKHR old_swapchain = VK_NULL_HANDLE);
         void create_image_views();
+        void create_depth_resources();
+        void destroy_depth_resources();
+        VkFormat find_depth_format() const;
         void create_render_pass();
         void create_descriptor_set_layout();
         void create_graphics_pipeline();
+        VkPipeline create_pipeline(const shader& vertex_shader, bool vertex_input, VkPipelineLayout layout);
+        void cull_objects(VkCommandBuffer command_buffer, const world& world, const camera& camera);
+        void prepare_instanced(const world& world);
+        void draw_indirect(VkCommandBuffer command_buffer, const world& world) const;
+        void draw_instance_groups(VkCommandBuffer command_buffer, size_t begin, size_t end) const;
+        void bind_instanced(VkCommandBuffer command_buffer) const;
+        void draw_gpu_culled(VkCommandBuffer command_buffer, const world& world) const;
+        void draw_objects(VkCommandBuffer command_buffer, const world& world, size_t begin, size_t end) const;
+        void ensure_instance_capacity(size_t instance_count);
         void create_framebuffers();
         void create_command_buffers();
         void create_sync_objects();
@@ -61,8 +119,12 @@ namespace voxel {
         void create_descriptor_pool();
         void create_descriptor_sets();
 
+        void destroy_swapchain_resources();
         void cleanup_swapchain();
         void recreate_swapchain();
+        void recreate_image_resources();
+        // Viewport и scissor на весь swapchain (динамическое состояние pipeline)
+        void set_viewport(VkCommandBuffer command_buffer) const;
 
         void update_uniform_buffer(const std::shared_ptr<camera>& camera);
 
@@ -81,12 +143,74 @@ namespace voxel {
         VkExtent2D swapchain_extent_{};
         std::vector<VkImageView> swapchain_image_views_;
 
+        // Буфер глубины размера swapchain, пересоздается вместе с ним
+        VkFormat depth_format_;
+        VkImage depth_image_;
+        VkImageView depth_image_view_;
+        gpu_allocation depth_allocation_;
+
         // Render pass и pipeline
         VkRenderPass render_pass_;
         VkDescriptorSetLayout descriptor_set_layout_;
         VkPipelineLayout pipeline_layout_;
         VkPipeline graphics_pipeline_;
 
+        // Pipeline мешей mesh_format::quads: вершины вытягиваются из буфера квадов (set 1)
+        VkPipelineLayout quad_pipeline_layout_;
+        VkPipeline quad_pipeline_;
+
+        // Pipeline индексированных мешей, рисуемых экземплярами: матрица экземпляра
+        // читается из storage buffer (set 1) по gl_InstanceIndex
+        VkPipelineLayout instanced_pipeline_layout_;
+        VkPipeline instanced_pipeline_;
+
+        // Объекты с общим мешем - экземпляры одного вызова отрисовки
+        struct instance_group {
+            mesh* pmesh;
+            uint32 first_instance;
+            uint32 instance_count;
+            uint32 written;
+        };
+
+        // Буферы экземпляров по кадрам в полете: матрицы и команды косвенной отрисовки арены
+        std::vector<std::unique_ptr<storage_buffer>> transform_buffers_;
+        std::vector<std::unique_ptr<indirect_buffer>> indirect_buffers_;
+        std::vector<size_t> instance_capacities_;
+        std::vector<VkDescriptorSet> transform_descriptor_sets_;
+        std::vector<instance_group> instance_groups_;
+        std::vector<uint32> group_draws_; // Группы, рисуемые вызовом на меш (не косвенно)
+        std::unordered_map<const mesh*, uint32> instance_group_lookup_;
+        std::vector<VkDrawIndexedIndirectCommand> indirect_commands_;
+        std::vector<object_transform_data> object_transforms_;
+        bool draw_indirect_;              // drawIndirectFirstInstance: арена рисуется одним вызовом
+        uint32 max_draw_indirect_count_;
+
+        // Отсечение пирамидой: AABB видимых объектов подряд (SoA), их индексы
+        // в списке объектов мира и итоговая маска по всем объектам мира
+        bool frustum_culling_ = true;
+        aabb_batch cull_bounds_;
+        std::vector<uint32> cull_indices_;
+        std::vector<uint8> cull_results_;
+        std::vector<uint8> object_visible_;
+        size_t culled_object_count_ = 0;
+
+        // Видимые объекты мира от ближних к дальним (квадрат расстояния до центра AABB)
+        std::vector<std::pair<float, uint32>> draw_order_keys_;
+        std::vector<uint32> draw_order_;
+
+        // Отсечение мешей арены на GPU (nullptr - недоступно)
+        std::unique_ptr<gpu_culler> gpu_culler_;
+        bool gpu_culling_ = true;
+
+        // Пирамида глубины для отсечения перекрытием (есть вместе с gpu_culler_)
+        std::unique_ptr<hiz_pyramid> hiz_;
+        bool occlusion_culling_ = true;
+
+        // Объекты, рисуемые по одному (индексы в списке объектов мира, от ближних к дальним),
+        // и параллельная запись их участков (nullptr - только основной поток)
+        std::vector<uint32> object_draws_;
+        std::unique_ptr<command_recorder> recorder_;
+
         // Framebuffers и команды
         std::vector<VkFramebuffer> framebuffers_;
         std::vector<VkCommandBuffer> command_buffers_;
@@ -95,6 +219,9 @@ namespace voxel {
         std::vector<VkSemaphore> image_available_semaphores_;
         std::vector<VkSemaphore> render_finished_semaphores_;
         std::vector<VkFence> in_flight_fences_;
+        std::vector<uint64> frame_serials_; // Номер кадра, отправленного с fence слота
+        uint64 submitted_frame_ = 0;        // Номер последнего отправленного кадра
+        uint64 completed_frame_ = 0;        // Кадры до этого номера включительно завершены GPU
 
         // Uniform buffers
         std::vector<std::unique_ptr<uniform_buffer>> uniform_buffers_;
@@ -103,15 +230,20 @@ namespace voxel {
 
         // Шейдеры
         std::unique_ptr<shader> vertex_shader_;
+        std::unique_ptr<shader> quad_vertex_shader_;
+        std::unique_ptr<shader> instanced_vertex_shader_;
         std::unique_ptr<shader> fragment_shader_;
 
         // Состояние рендеринга
         uint32_t current_frame_;
         uint32_t current_image_index_;
         bool framebuffer_resized_;
+        bool frame_started_ = false;      // begin_frame получил изображение: кадр записывается и отправляется
         colorf clear_color_;
         std::vector<VkFence> images_in_flight_; // Fences для каждого изображения swapchain
 
         static const int MAX_FRAMES_IN_FLIGHT = 2;
+        static constexpr size_t PARALLEL_RECORDING_MIN_DRAWS = 128;
+        static constexpr size_t RECORDING_RANGE_SIZE = 64; // Вызовов отрисовки в одном вторичном буфере
     };
 }
\ No newline at end of file
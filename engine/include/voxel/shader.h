@@ -9,7 +9,8 @@ namespace voxel {
 
     enum class shader_type {
         VERTEX,
-        FRAGMENT
+        FRAGMENT,
+        COMPUTE
     };
 
     class shader {
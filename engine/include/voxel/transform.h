@@ -11,9 +11,14 @@ private:
     vec3f rotation_{0.0f, 0.0f, 0.0f}; // углы в радианах
     vec3f scale_{1.0f, 1.0f, 1.0f};
     
-    // Кэшированная матрица трансформации
+    // Кэшированные матрицы трансформации и нормалей
     mutable mat4f cached_matrix;
+    mutable mat4f cached_normal_matrix;
     mutable bool matrix_dirty = true;
+    
+    // Номер версии: уникален для каждого изменения среди всех трансформаций,
+    // копия сохраняет версию вместе со значениями
+    mutable uint64 version_ = 0;
 
 public:
     // Геттеры
@@ -24,6 +29,9 @@ public:
     // Получить матрицу трансформации (с кэшированием)
     const mat4f& get_matrix() const;
     
+    // Матрица нормалей (math::normal_matrix), пересчитывается вместе с матрицей
+    const mat4f& get_normal_matrix() const;
+    
     // Методы для изменения трансформации
     void set_position(const vec3f& pos);
     void set_rotation(const vec3f& rot);
@@ -33,8 +41,14 @@ public:
     void rotate(const vec3f& angles);
     void scale(const vec3f& factor);
     
+    // Версия для кэшей, зависящих от трансформации
+    uint64 get_version() const { return version_; }
+    
     // Сбросить кэш матрицы
-    void mark_dirty() const { matrix_dirty = true; }
+    void mark_dirty() const;
+
+private:
+    void update_matrices() const;
 };
 
 } 
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <deque>
+#include <vulkan/vulkan.h>
+
+#include <voxel/types.h>
+#include <voxel/buffer.h>
+
+namespace voxel {
+    class vulkan_context;
+
+    // Загрузка данных в DEVICE_LOCAL буферы через постоянный кольцевой staging буфер.
+    // Копирования накапливаются в пакет и отправляются одним vkQueueSubmit с fence;
+    // место в кольце освобождается по мере завершения пакетов, без ожидания очереди.
+    // Используется из одного (основного) потока.
+    class upload_queue {
+    public:
+        static constexpr VkDeviceSize DEFAULT_RING_SIZE = 32ull * 1024 * 1024;
+
+        upload_queue(std::shared_ptr<vulkan_context> context, VkDeviceSize ring_size = DEFAULT_RING_SIZE);
+        ~upload_queue(); // Дожидается завершения отправленных пакетов
+
+        // Запретить копирование
+        upload_queue(const upload_queue&) = delete;
+        upload_queue& operator=(const upload_queue&) = delete;
+
+        // Копирует data в staging кольцо и записывает копирование в dst (буфер с TRANSFER_DST).
+        // dst должен жить до завершения пакета. Данные больше кольца идут через
+        // временный staging буфер того же пакета
+        void upload(buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+        // Отправляет накопленный пакет; барьер в конце пакета делает данные
+        // видимыми для чтения вершин, индексов и storage буферов в последующих отправках
+        void flush();
+
+        // Освобождает место завершенных пакетов (не блокирует)
+        void collect();
+
+        // Номер последнего пакета (записываемого или отправленного) и номер, до
+        // которого включительно пакеты завершены. Копирования, записанные до
+        // get_last_batch, завершены, когда get_completed_batch его достиг
+        uint64 get_last_batch() const { return batch_serial_; }
+        uint64 get_completed_batch() const { return completed_batch_; }
+
+        size_t get_pending_batch_count() const { return in_flight_.size(); }
+        VkDeviceSize get_ring_size() const { return ring_size_; }
+        uint64 get_uploaded_bytes() const { return uploaded_bytes_; }
+
+    private:
+        struct batch {
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            uint64 serial = 0;
+            VkDeviceSize ring_end = 0;                        // Позиция head кольца после пакета
+            bool uses_ring = false;                           // Пакет занимает место в кольце
+            std::vector<std::unique_ptr<buffer>> temporaries; // Staging буферы крупных загрузок
+        };
+
+        void begin_batch();
+        void retire(batch& completed);
+        bool try_allocate(VkDeviceSize size, VkDeviceSize& offset);
+        VkDeviceSize allocate(VkDeviceSize size);
+
+        std::shared_ptr<vulkan_context> context_;
+        VkCommandPool command_pool_;
+
+        std::unique_ptr<buffer> ring_;
+        uint8* ring_data_;
+        VkDeviceSize ring_size_;
+        VkDeviceSize head_ = 0;    // Начало свободной области
+        VkDeviceSize tail_ = 0;    // Начало самой старой занятой области
+        bool ring_in_use_ = false; // Различает пустое и полное кольцо при head_ == tail_
+        size_t ring_batches_ = 0;  // Пакеты (записываемый и отправленные) с данными в кольце
+
+        std::unique_ptr<batch> current_;          // Записываемый пакет (nullptr - пусто)
+        std::deque<std::unique_ptr<batch>> in_flight_; // Отправленные пакеты в порядке отправки
+        std::vector<std::unique_ptr<batch>> free_;     // Переиспользуемые command buffer и fence
+
+        uint64 uploaded_bytes_ = 0;
+        uint64 batch_serial_ = 0;
+        uint64 completed_batch_ = 0;
+    };
+}
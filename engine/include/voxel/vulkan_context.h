@@ -6,6 +6,8 @@
 #include <vulkan/vulkan.h>
 
 #include "types.h"
+#include "gpu_allocator.h"
+#include "pipeline_cache.h"
 
 namespace voxel {
     class window;
@@ -41,6 +43,17 @@ namespace voxel {
         VkQueue get_present_queue() const { return present_queue_; }
         VkSurfaceKHR get_surface() const { return surface_; }
         VkCommandPool get_command_pool() const { return command_pool_; }
+        // Возможности, включенные при создании логического устройства
+        const VkPhysicalDeviceFeatures& get_enabled_features() const { return enabled_features_; }
+        // vkCmdDrawIndexedIndirectCountKHR (VK_KHR_draw_indirect_count); nullptr - не поддерживается
+        PFN_vkCmdDrawIndexedIndirectCountKHR get_cmd_draw_indexed_indirect_count() const { return cmd_draw_indexed_indirect_count_; }
+        // Распределитель памяти для всех буферов движка
+        gpu_allocator& get_allocator() const { return *allocator_; }
+        // Общий кэш для всех pipeline движка, сохраняется в файл при уничтожении контекста
+        VkPipelineCache get_pipeline_cache() const { return pipeline_cache_->get_cache(); }
+        // Layout набора с одним storage buffer в binding 0 для вершинного шейдера
+        // (буфер квадов меша, матрицы объектов при косвенной отрисовке)
+        VkDescriptorSetLayout get_quad_set_layout() const { return quad_set_layout_; }
         
         queue_family_indices get_queue_families() const { return queue_families_; }
         swapchain_support_details query_swapchain_support() const;
@@ -51,6 +64,7 @@ namespace voxel {
         void pick_physical_device();
         void create_logical_device();
         void create_command_pool();
+        void create_quad_set_layout();
 
         bool is_device_suitable(VkPhysicalDevice device);
         queue_family_indices find_queue_families(VkPhysicalDevice device);
@@ -65,7 +79,12 @@ namespace voxel {
         VkQueue graphics_queue_;
         VkQueue present_queue_;
         VkCommandPool command_pool_;
+        VkDescriptorSetLayout quad_set_layout_;
+        std::unique_ptr<gpu_allocator> allocator_;
+        std::unique_ptr<pipeline_cache> pipeline_cache_;
         queue_family_indices queue_families_;
+        VkPhysicalDeviceFeatures enabled_features_{};
+        PFN_vkCmdDrawIndexedIndirectCountKHR cmd_draw_indexed_indirect_count_ = nullptr;
 
         std::vector<const char*> device_extensions_;
 
@@ -2,19 +2,25 @@
 #include <vector>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <optional>
 #include <future>
-#include <mutex>
-#include <condition_variable>
-#include <thread>
-#include <queue>
+#include <atomic>
 
 #include <voxel/types.h>
 #include <voxel/model.h>
 #include <voxel/mesh.h>
 #include <voxel/transform.h>
+#include <voxel/frustum.h>
+#include <voxel/mesh_worker_pool.h>
+#include <voxel/upload_queue.h>
+#include <voxel/mesh_arena.h>
+#include <voxel/mesh_cache.h>
+#include <voxel/chunk.h>
 
 namespace voxel {
     class vulkan_context;
+    class camera;
 
     // Структура для хранения размещенного объекта в мире
     struct world_object {
@@ -24,25 +30,44 @@ namespace voxel {
         std::shared_ptr<mesh> pmesh;   // Кэшированный меш
         bool mesh_dirty = true;       // Флаг необходимости пересоздания меша
         bool visible = true;          // Видимость объекта
+        bool shared_mesh = false;     // Меш общий для всех объектов модели (add_object)
         std::future<mesh_data> mesh_future; // Future для асинхронной генерации
+        std::shared_ptr<std::atomic<bool>> mesh_cancel; // Токен отмены текущей задачи генерации
+        std::optional<mesh_cache_key> mesh_key;         // Ключ кэша текущей задачи или ожидаемого меша
+        bool waits_mesh_cache = false;                  // Меш с тем же ключом строит другая задача
         
         world_object(object_id id, std::shared_ptr<model> pmodel)
             : id(id), pmodel(pmodel) {}
+
+        // AABB модели в мировых координатах; пересчитывается при изменении
+        // трансформации, модели или её размеров
+        const aabb& get_world_bounds() const;
+
+    private:
+        mutable aabb bounds_;
+        mutable uint64 bounds_version_ = ~0ull;
+        mutable const model* bounds_model_ = nullptr;
+        mutable vec3i bounds_size_;
     };
 
-    // Задача генерации меша
-    struct mesh_generation_task {
-        object_id id;
+    // Меш модели, общий для объектов с этой моделью: модель мешится и загружается
+    // один раз, сколько бы объектов её ни использовали
+    struct shared_model_mesh {
         std::shared_ptr<model> pmodel;
-        std::promise<mesh_data> promise;
-        
-        mesh_generation_task(object_id id, std::shared_ptr<model> pmodel)
-            : id(id), pmodel(pmodel) {}
+        std::shared_ptr<mesh> pmesh;
+        std::future<mesh_data> mesh_future;
+        std::shared_ptr<std::atomic<bool>> mesh_cancel;
+        std::optional<mesh_cache_key> mesh_key;
+        bool waits_mesh_cache = false;
+        size_t ref_count = 0;         // Число объектов с этой моделью
+        object_id owner = 0;          // Объект, по которому считается приоритет генерации
+        bool mesh_dirty = true;
     };
 
     class world {
     public:
-        world(std::shared_ptr<vulkan_context> context);
+        // mesh_thread_count = 0 - по числу аппаратных потоков
+        world(std::shared_ptr<vulkan_context> context, size_t mesh_thread_count = 0);
         ~world();
 
         // Запретить копирование
@@ -83,14 +108,79 @@ namespace voxel {
         void set_object_model(object_id id, std::shared_ptr<model> new_model);
         std::shared_ptr<model> get_object_model(object_id id) const;
 
+        // Перестроить меш модели после её прямого изменения (у всех объектов модели)
+        void mark_model_dirty(const std::shared_ptr<model>& model);
+        size_t get_shared_mesh_count() const { return shared_meshes_.size(); }
+
         // Методы для работы с видимостью
         void set_object_visible(object_id id, bool visible);
         bool is_object_visible(object_id id) const;
 
+        // Ландшафт из чанков CHUNK_SIZE^3: каждый чанк мешится отдельно,
+        // так что правка блока перестраивает меш только своего чанка
+        std::shared_ptr<chunk> create_chunk(const chunk_coord& coord); // Возвращает существующий, если есть
+        std::shared_ptr<chunk> insert_chunk(const chunk_coord& coord, std::shared_ptr<model> chunk_model); // Заменяет существующий
+        void remove_chunk(const chunk_coord& coord);
+        std::shared_ptr<chunk> get_chunk(const chunk_coord& coord) const;
+        const chunk_map& get_chunks() const { return chunks_; }
+        size_t get_chunk_count() const { return chunks_.size(); }
+
+        // Холодный чанк хранит воксели только в сжатом виде (меш остается);
+        // правка или перестроение меша распаковывают его обратно.
+        // false - чанк отсутствует или ждет генерации меша.
+        bool set_chunk_cold(const chunk_coord& coord, bool cold);
+
+        // Модель чанка для чтения (копия распакованных данных для холодного чанка)
+        std::shared_ptr<const model> get_chunk_model(const chunk_coord& coord) const;
+
+        // Блоки в мировых координатах; отсутствующий чанк создается при установке непустого блока
+        void set_block(int x, int y, int z, const voxel& voxel);
+        voxel get_block(int x, int y, int z) const;
+
+        // Пометить чанк и его соседей для перестроения после прямого изменения модели чанка
+        void mark_chunk_dirty(const chunk_coord& coord);
+
+        // Копии чанков, измененных после прошлого вызова (для сохранения); флаги сбрасываются
+        std::vector<chunk_snapshot> take_unsaved_chunks();
+
         // Методы для рендеринга
         void update_meshes(); // Пересоздает меши для объектов с mesh_dirty = true
+        // Вызывается renderer::render_world: frame - записываемый кадр, completed_frame -
+        // кадры до него включительно завершены GPU. Замененные меши освобождаются по нему
+        void set_frame_progress(uint64 frame, uint64 completed_frame);
         const std::vector<std::shared_ptr<world_object>>& get_renderable_objects() const { return objects_; }
 
+        // Камера, относительно которой упорядочиваются задачи генерации мешей
+        void set_camera(std::shared_ptr<camera> camera) { camera_ = std::move(camera); }
+
+        // Настройка пула генерации мешей
+        void set_mesh_thread_count(size_t thread_count) { mesh_workers_.set_thread_count(thread_count); }
+        size_t get_mesh_thread_count() const { return mesh_workers_.get_thread_count(); }
+        std::vector<size_t> get_mesh_queue_depths() const { return mesh_workers_.get_queue_depths(); }
+
+        // Формат новых мешей; mesh_format::quads рисуется pipeline с вытягиванием вершин.
+        // Уже построенные меши перестраиваются при следующем изменении.
+        void set_mesh_format(mesh_format format) { mesh_format_ = format; }
+        mesh_format get_mesh_format() const { return mesh_format_; }
+
+        // Новые индексированные меши размещаются в общей арене вершин и индексов;
+        // renderer рисует их одним vkCmdDrawIndexedIndirect. Меши, не поместившиеся
+        // в арену, и уже построенные меши остаются в своих буферах.
+        void set_mesh_arena_enabled(bool enabled);
+        bool is_mesh_arena_enabled() const { return arena_ != nullptr; }
+        std::shared_ptr<mesh_arena> get_mesh_arena() const { return arena_; }
+
+        // Кэш мешей по содержимому моделей: модели с равными вокселями (и чанки
+        // с равными соседями) мешатся один раз, в том числе одновременно
+        // запрошенные. memory_limit = 0 выключает кэш
+        void set_mesh_cache_limits(size_t memory_limit, size_t entry_limit = 0);
+        const mesh_cache& get_mesh_cache() const { return mesh_cache_; }
+
+        // Лимит объема данных мешей, загружаемых в GPU за кадр (0 - без лимита).
+        // Хотя бы один готовый меш загружается всегда.
+        void set_mesh_upload_budget(size_t bytes) { mesh_upload_budget_ = bytes; }
+        size_t get_mesh_upload_budget() const { return mesh_upload_budget_; }
+
         // Утилиты
         object_id get_next_object_id() { return next_object_id_++; }
         bool object_exists(object_id id) const;
@@ -99,19 +189,75 @@ namespace voxel {
         std::shared_ptr<vulkan_context> context_;
         std::vector<std::shared_ptr<world_object>> objects_;
         std::unordered_map<object_id, std::weak_ptr<world_object>> object_map_; // Быстрый поиск по ID
+        std::unordered_map<const model*, shared_model_mesh> shared_meshes_;    // Общие меши моделей объектов
         object_id next_object_id_ = 1;
 
+        // Замененные и удаленные меши: их буферы могут читать кадры в полете или
+        // ожидающее копирование пакета загрузки, поэтому они освобождаются после
+        // завершения кадра и пакета, записанных до отложения. Объявлены до uploads_,
+        // чтобы разрушаться после него
+        struct retired_mesh {
+            std::shared_ptr<mesh> pmesh;
+            uint64 frame;        // Последний кадр, который мог читать меш
+            uint64 upload_batch; // Последний пакет загрузки, который мог в него писать
+        };
+        std::vector<retired_mesh> retired_meshes_;
+        uint64 frame_ = 0;           // Записываемый кадр рендерера
+        uint64 completed_frame_ = 0; // Кадры до этого номера завершены GPU
+
+        // Загрузка готовых мешей в DEVICE_LOCAL память одним пакетом за кадр.
+        // Объявлена после objects_: разрушается раньше мешей и дожидается их копирований
+        std::unique_ptr<upload_queue> uploads_;
+
+        // Общая арена мешей (nullptr - режим выключен)
+        std::shared_ptr<mesh_arena> arena_;
+
+        // Кэш мешей и ключи мешей, которые сейчас строятся
+        mesh_cache mesh_cache_;
+        std::unordered_set<mesh_cache_key, mesh_cache_key_hash> pending_mesh_keys_;
+        std::unordered_map<mesh_cache_key, std::shared_ptr<mesh>, mesh_cache_key_hash> completed_meshes_; // Меши текущего кадра
+        bool shared_meshes_changed_ = false;
+
+        // Сетка чанков и чанки, измененные с прошлого update_meshes
+        chunk_map chunks_;
+        std::unordered_map<object_id, chunk_coord> chunk_objects_;
+        std::vector<chunk_coord> dirty_chunks_;
+
+        // Приоритет задач генерации: ближние и крупные на экране объекты - первыми
+        std::shared_ptr<camera> camera_;
+        vec3f priority_camera_position_;
+        vec3f priority_camera_forward_;
+
+        // Пересортировка очередей при смещении или повороте камеры
+        static constexpr float PRIORITY_REFRESH_DISTANCE = 1.0f;
+        static constexpr float PRIORITY_REFRESH_COS_ANGLE = 0.95f;
+
+        size_t mesh_upload_budget_ = 0;
+        mesh_format mesh_format_ = mesh_format::indexed;
+
         // Система асинхронной генерации мешей
-        std::thread worker_thread_;
-        std::queue<std::unique_ptr<mesh_generation_task>> task_queue_;
-        std::mutex task_mutex_;
-        std::condition_variable task_cv_;
-        bool worker_running_ = true;
+        mesh_worker_pool mesh_workers_;
 
         // Внутренние методы
         void mark_object_mesh_dirty(object_id id);
         void update_object_mesh(std::shared_ptr<world_object> obj);
-        void worker_thread_function();
+        void cancel_object_mesh(world_object& obj);
+        void acquire_shared_mesh(world_object& obj);
+        void release_shared_mesh(world_object& obj);
+        void update_shared_mesh(shared_model_mesh& entry);
+        void cancel_shared_mesh(shared_model_mesh& entry);
+        void assign_shared_meshes();
+        void set_mesh(std::shared_ptr<mesh>& slot, std::shared_ptr<mesh> pmesh);
+        void retire_mesh(std::shared_ptr<mesh> pmesh);
+        void release_retired_meshes();
+        std::shared_ptr<mesh> create_mesh(mesh_data&& data, const std::optional<mesh_cache_key>& key, size_t& uploaded);
+        bool resolve_cached_mesh(const mesh_cache_key& key, std::shared_ptr<mesh>& pmesh);
         void process_completed_meshes();
+        void flush_dirty_chunks();
+        void mark_chunk_mesh_dirty(const chunk_coord& coord);
+        void warm_chunk(chunk& target);
+        std::shared_ptr<const mesh_borders> capture_chunk_borders(const chunk_coord& coord) const;
+        float compute_mesh_priority(const world_object& obj) const;
+        void update_mesh_priorities();
     };
 } 
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <string>
+#include <filesystem>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#include <voxel/types.h>
+#include <voxel/model.h>
+#include <voxel/chunk.h>
+#include <voxel/region_file.h>
+
+namespace voxel {
+    class world;
+
+    // Сохранение чанков мира в файлы регионов каталога Worlds/<name>.
+    // Запись идет в фоновом потоке; сохраняются только измененные чанки.
+    class world_storage {
+    public:
+        explicit world_storage(const std::string& name, const std::filesystem::path& root = "Worlds");
+        ~world_storage(); // Дописывает очередь сохранения
+
+        // Запретить копирование и перемещение
+        world_storage(const world_storage&) = delete;
+        world_storage& operator=(const world_storage&) = delete;
+
+        const std::filesystem::path& get_path() const { return path_; }
+
+        // Загрузка чанка; nullptr - чанк не сохранялся. Потокобезопасно,
+        // учитывает снимки, еще не записанные на диск. Поврежденные данные - std::runtime_error.
+        std::shared_ptr<model> load_chunk(const chunk_coord& coord);
+
+        // Снимки чанков ставятся в очередь фоновой записи
+        void save_chunks_async(std::vector<chunk_snapshot> chunks);
+        void flush(); // Дождаться записи очереди
+        size_t get_pending_count() const;
+
+        // Сохранение измененных чанков мира (снимки снимаются в вызывающем потоке)
+        void save(world& world);
+
+        // Автосохранение: update вызывается каждый кадр и раз в interval сохраняет мир
+        void set_autosave_interval(std::chrono::seconds interval) { autosave_interval_ = interval; }
+        std::chrono::seconds get_autosave_interval() const { return autosave_interval_; }
+        void update(world& world);
+
+    private:
+        region_file* get_region(const chunk_coord& region, bool create);
+        void writer_function();
+
+        std::filesystem::path path_;
+
+        std::chrono::seconds autosave_interval_{300};
+        std::chrono::steady_clock::time_point last_autosave_;
+
+        // Открытые файлы регионов
+        std::mutex regions_mutex_;
+        std::unordered_map<chunk_coord, std::unique_ptr<region_file>, chunk_coord_hash> regions_;
+
+        // Очередь записи: последний снимок каждого чанка
+        mutable std::mutex mutex_;
+        std::condition_variable writer_cv_;
+        std::condition_variable flushed_cv_;
+        std::unordered_map<chunk_coord, std::shared_ptr<const model>, chunk_coord_hash> pending_;
+        bool writing_ = false;
+        bool stop_ = false;
+        std::thread writer_;
+    };
+}
@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include <voxel/brick_storage.h>
+
+namespace voxel {
+
+brick_storage::brick_storage(int width, int height, int depth)
+    : bricks_x_((width + BRICK_MASK) >> BRICK_SHIFT),
+      bricks_y_((height + BRICK_MASK) >> BRICK_SHIFT),
+      bricks_z_((depth + BRICK_MASK) >> BRICK_SHIFT),
+      bricks_(static_cast<size_t>(bricks_x_) * bricks_y_ * bricks_z_) {
+}
+
+void brick_storage::set(int x, int y, int z, const voxel& value) {
+    brick& b = bricks_[brick_index(x >> BRICK_SHIFT, y >> BRICK_SHIFT, z >> BRICK_SHIFT)];
+    if (b.slot == NO_SLOT) {
+        if (b.uniform.color == value.color) return;
+        b.slot = allocate_slot(b.uniform);
+    }
+    pool_[b.slot + local_index(x, y, z)] = value;
+}
+
+void brick_storage::fill(const voxel& value) {
+    for (auto& b : bricks_) {
+        b.uniform = value;
+        b.slot = NO_SLOT;
+    }
+    pool_.clear();
+    free_slots_.clear();
+}
+
+void brick_storage::optimize() {
+    for (auto& b : bricks_) {
+        if (b.slot == NO_SLOT) continue;
+
+        const auto begin = pool_.begin() + b.slot;
+        const uint32 color = begin->color;
+        if (std::all_of(begin, begin + BRICK_VOLUME, [color](const voxel& v) { return v.color == color; })) {
+            release_slot(b);
+            b.uniform = voxel(color);
+        }
+    }
+
+    // Уплотняем пул: оставшиеся кирпичи переносятся подряд без дыр
+    std::vector<voxel> pool;
+    pool.reserve(allocated_brick_count() * BRICK_VOLUME);
+    for (auto& b : bricks_) {
+        if (b.slot == NO_SLOT) continue;
+
+        const uint32 slot = static_cast<uint32>(pool.size());
+        pool.insert(pool.end(), pool_.begin() + b.slot, pool_.begin() + b.slot + BRICK_VOLUME);
+        b.slot = slot;
+    }
+    pool_ = std::move(pool);
+    free_slots_ = std::vector<uint32>();
+}
+
+size_t brick_storage::memory_usage() const {
+    return bricks_.capacity() * sizeof(brick) +
+           pool_.capacity() * sizeof(voxel) +
+           free_slots_.capacity() * sizeof(uint32);
+}
+
+uint32 brick_storage::allocate_slot(const voxel& value) {
+    uint32 slot;
+    if (!free_slots_.empty()) {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+        std::fill(pool_.begin() + slot, pool_.begin() + slot + BRICK_VOLUME, value);
+    } else {
+        slot = static_cast<uint32>(pool_.size());
+        pool_.resize(pool_.size() + BRICK_VOLUME, value);
+    }
+    return slot;
+}
+
+void brick_storage::release_slot(brick& b) {
+    free_slots_.push_back(b.slot);
+    b.slot = NO_SLOT;
+}
+
+} // namespace voxel
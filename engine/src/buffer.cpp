@@ -14,8 +14,7 @@ buffer::buffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties
 )
-    : context_(std::move(context)), buffer_(VK_NULL_HANDLE), memory_(VK_NULL_HANDLE), 
-      size_(size), mapped_memory_(nullptr) {
+    : size_(size), context_(std::move(context)), buffer_(VK_NULL_HANDLE) {
     
     VkBufferCreateInfo buffer_info{};
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -30,16 +29,15 @@ buffer::buffer(
     VkMemoryRequirements mem_requirements;
     vkGetBufferMemoryRequirements(context_->get_device(), buffer_, &mem_requirements);
 
-    VkMemoryAllocateInfo alloc_info{};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = mem_requirements.size;
-    alloc_info.memoryTypeIndex = find_memory_type(mem_requirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(context_->get_device(), &alloc_info, nullptr, &memory_) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate buffer memory");
+    // Память выделяется участком общего блока, а не отдельным vkAllocateMemory
+    try {
+        allocation_ = context_->get_allocator().allocate(mem_requirements, properties);
+    } catch (...) {
+        vkDestroyBuffer(context_->get_device(), buffer_, nullptr);
+        throw;
     }
 
-    vkBindBufferMemory(context_->get_device(), buffer_, memory_, 0);
+    vkBindBufferMemory(context_->get_device(), buffer_, allocation_.memory, allocation_.offset);
 }
 
 buffer::~buffer() {
@@ -47,12 +45,10 @@ buffer::~buffer() {
 }
 
 buffer::buffer(buffer&& other) noexcept 
-    : context_(other.context_), buffer_(other.buffer_), memory_(other.memory_), 
-      size_(other.size_), mapped_memory_(other.mapped_memory_) {
+    : size_(other.size_), context_(other.context_), buffer_(other.buffer_), allocation_(other.allocation_) {
     other.buffer_ = VK_NULL_HANDLE;
-    other.memory_ = VK_NULL_HANDLE;
+    other.allocation_ = gpu_allocation();
     other.size_ = 0;
-    other.mapped_memory_ = nullptr;
 }
 
 buffer& buffer::operator=(buffer&& other) noexcept {
@@ -61,32 +57,25 @@ buffer& buffer::operator=(buffer&& other) noexcept {
         // `context_` является ссылкой и не может быть переприсвоена, 
         // предполагается, что оба буфера находятся в одном контексте.
         buffer_ = other.buffer_;
-        memory_ = other.memory_;
+        allocation_ = other.allocation_;
         size_ = other.size_;
-        mapped_memory_ = other.mapped_memory_;
 
         other.buffer_ = VK_NULL_HANDLE;
-        other.memory_ = VK_NULL_HANDLE;
+        other.allocation_ = gpu_allocation();
         other.size_ = 0;
-        other.mapped_memory_ = nullptr;
     }
     return *this;
 }
 
 void* buffer::map() {
-    if (mapped_memory_ == nullptr) {
-        if (vkMapMemory(context_->get_device(), memory_, 0, size_, 0, &mapped_memory_) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to map buffer memory");
-        }
+    if (allocation_.mapped == nullptr) {
+        throw std::runtime_error("Failed to map buffer memory");
     }
-    return mapped_memory_;
+    return allocation_.mapped;
 }
 
 void buffer::unmap() {
-    if (mapped_memory_ != nullptr) {
-        vkUnmapMemory(context_->get_device(), memory_);
-        mapped_memory_ = nullptr;
-    }
+    // Блоки отображены на всё время жизни - отдельное отображение не снимается
 }
 
 void buffer::copy_from(const void* data, VkDeviceSize size, VkDeviceSize offset) {
@@ -135,28 +124,13 @@ void buffer::copy_to_buffer(
     vkFreeCommandBuffers(context_->get_device(), context_->get_command_pool(), 1, &command_buffer);
 }
 
-uint32 buffer::find_memory_type(uint32 type_filter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties mem_properties;
-    vkGetPhysicalDeviceMemoryProperties(context_->get_physical_device(), &mem_properties);
-
-    for (uint32 i = 0; i < mem_properties.memoryTypeCount; i++) {
-        if ((type_filter & (1 << i)) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-
-    throw std::runtime_error("Failed to find suitable memory type");
-}
-
 void buffer::cleanup() {
-    if (mapped_memory_) {
-        unmap();
-    }
     if (buffer_ != VK_NULL_HANDLE) {
         vkDestroyBuffer(context_->get_device(), buffer_, nullptr);
+        buffer_ = VK_NULL_HANDLE;
     }
-    if (memory_ != VK_NULL_HANDLE) {
-        vkFreeMemory(context_->get_device(), memory_, nullptr);
+    if (allocation_) {
+        context_->get_allocator().free(allocation_);
     }
 }
 
@@ -49,7 +49,8 @@ mat4f camera::get_projection_matrix() const {
 }
 
 mat4f camera::get_view_projection_matrix() const {
-    return math::multiply_matrices(get_projection_matrix(), get_view_matrix());
+    // Вектор-строка (как в шейдерах): сначала view, затем projection
+    return math::multiply_matrices(get_view_matrix(), get_projection_matrix());
 }
 
 void camera::move_forward(float distance) {
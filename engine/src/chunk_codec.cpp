@@ -0,0 +1,321 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include <voxel/chunk_codec.h>
+#include <voxel/chunk.h>
+
+namespace voxel {
+
+namespace {
+    // Формат данных (первое слово заголовка)
+    enum class chunk_format : uint32 {
+        raw = 0,   // Цвета чанка подряд без заголовка (первая версия файлов регионов)
+        rle_lz = 1 // Палитра + серии индексов + LZ
+    };
+
+    // Параметры LZ: минимальное совпадение 4 байта, смещение до 64 КиБ
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t MAX_OFFSET = 0xFFFF;
+    constexpr int HASH_BITS = 12;
+
+    inline uint32 read32(const uint8* p) {
+        uint32 value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32 hash32(uint32 value) {
+        return (value * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void write32(std::vector<uint8>& out, uint32 value) {
+        const size_t offset = out.size();
+        out.resize(offset + sizeof(value));
+        std::memcpy(out.data() + offset, &value, sizeof(value));
+    }
+
+    uint32 take32(const uint8*& in, const uint8* end) {
+        if (end - in < static_cast<std::ptrdiff_t>(sizeof(uint32))) {
+            throw std::runtime_error("chunk_codec: truncated data");
+        }
+        const uint32 value = read32(in);
+        in += sizeof(uint32);
+        return value;
+    }
+
+    // Длина LZ-последовательности: 4 бита в токене, остаток байтами по 255
+    void write_length(std::vector<uint8>& out, size_t length) {
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<uint8>(length));
+    }
+
+    size_t read_length(const uint8*& in, const uint8* end) {
+        size_t length = 0;
+        uint8 byte;
+        do {
+            if (in >= end) throw std::runtime_error("chunk_codec: truncated data");
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return length;
+    }
+}
+
+std::vector<uint8> chunk_codec::encode(const model& chunk_model) {
+    const int width = chunk_model.width();
+    const int height = chunk_model.height();
+    const int depth = chunk_model.depth();
+    
+    // Серии одинаковых цветов в порядке x -> y -> z
+    std::vector<uint32> palette;
+    std::unordered_map<uint32, uint32> palette_map;
+    std::vector<uint8> runs;
+    uint32 run_index = 0;
+    uint32 run_length = 0;
+    uint32 last_color = 0;
+    uint32 last_index = 0;
+    
+    for (int z = 0; z < depth; z++) {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                const uint32 color = chunk_model.get_voxel_unchecked(x, y, z).color;
+                
+                uint32 index = last_index;
+                if (color != last_color || palette.empty()) {
+                    auto [it, inserted] = palette_map.try_emplace(color, static_cast<uint32>(palette.size()));
+                    if (inserted) {
+                        palette.push_back(color);
+                    }
+                    index = it->second;
+                    last_color = color;
+                    last_index = index;
+                }
+                
+                if (run_length > 0 && index == run_index) {
+                    run_length++;
+                    continue;
+                }
+                if (run_length > 0) {
+                    write_varint(runs, run_index);
+                    write_varint(runs, run_length);
+                }
+                run_index = index;
+                run_length = 1;
+            }
+        }
+    }
+    if (run_length > 0) {
+        write_varint(runs, run_index);
+        write_varint(runs, run_length);
+    }
+    
+    std::vector<uint8> out;
+    write32(out, static_cast<uint32>(chunk_format::rle_lz));
+    write32(out, static_cast<uint32>(width));
+    write32(out, static_cast<uint32>(height));
+    write32(out, static_cast<uint32>(depth));
+    write32(out, static_cast<uint32>(palette.size()));
+    for (uint32 color : palette) {
+        write32(out, color);
+    }
+    write32(out, static_cast<uint32>(runs.size()));
+    
+    std::vector<uint8> packed = compress(runs.data(), runs.size());
+    out.insert(out.end(), packed.begin(), packed.end());
+    return out;
+}
+
+std::shared_ptr<model> chunk_codec::decode(const uint8* data, size_t size) {
+    const uint8* in = data;
+    const uint8* end = data + size;
+    
+    const uint32 format = take32(in, end);
+    
+    // Сырые данные (первая версия файлов регионов) - всегда чанк CHUNK_SIZE^3
+    const bool raw = format == static_cast<uint32>(chunk_format::raw);
+    const int width = raw ? CHUNK_SIZE : static_cast<int>(take32(in, end));
+    const int height = raw ? CHUNK_SIZE : static_cast<int>(take32(in, end));
+    const int depth = raw ? CHUNK_SIZE : static_cast<int>(take32(in, end));
+    if (width <= 0 || height <= 0 || depth <= 0 || width > 1024 || height > 1024 || depth > 1024) {
+        throw std::runtime_error("chunk_codec: invalid dimensions");
+    }
+    const size_t count = static_cast<size_t>(width) * height * depth;
+    
+    auto chunk_model = std::make_shared<model>(width, height, depth, model_storage::sparse);
+    auto set_range = [&](size_t begin, size_t length, uint32 color) {
+        if (color == 0) return;
+        for (size_t i = begin; i < begin + length; i++) {
+            const int x = static_cast<int>(i % width);
+            const int y = static_cast<int>(i / width % height);
+            const int z = static_cast<int>(i / (static_cast<size_t>(width) * height));
+            chunk_model->set_voxel(x, y, z, voxel(color));
+        }
+    };
+    
+    if (raw) {
+        if (static_cast<size_t>(end - in) != count * sizeof(uint32)) {
+            throw std::runtime_error("chunk_codec: invalid raw data size");
+        }
+        for (size_t i = 0; i < count; i++) {
+            set_range(i, 1, read32(in + i * sizeof(uint32)));
+        }
+    } else if (format == static_cast<uint32>(chunk_format::rle_lz)) {
+        const uint32 palette_size = take32(in, end);
+        if (palette_size > count || palette_size > static_cast<size_t>(end - in) / sizeof(uint32)) {
+            throw std::runtime_error("chunk_codec: invalid palette");
+        }
+        std::vector<uint32> palette(palette_size);
+        for (uint32& color : palette) {
+            color = take32(in, end);
+        }
+        
+        // Серия занимает не больше двух varint по 5 байт
+        const uint32 runs_size = take32(in, end);
+        if (runs_size > count * 10) {
+            throw std::runtime_error("chunk_codec: invalid runs size");
+        }
+        
+        std::vector<uint8> runs = decompress(in, end - in, runs_size);
+        const uint8* run = runs.data();
+        const uint8* runs_end = run + runs.size();
+        
+        size_t position = 0;
+        while (run < runs_end) {
+            const uint32 index = read_varint(run, runs_end);
+            const uint32 length = read_varint(run, runs_end);
+            if (index >= palette.size() || length > count - position) {
+                throw std::runtime_error("chunk_codec: invalid run");
+            }
+            set_range(position, length, palette[index]);
+            position += length;
+        }
+        if (position != count) {
+            throw std::runtime_error("chunk_codec: incomplete runs");
+        }
+    } else {
+        throw std::runtime_error("chunk_codec: unknown format");
+    }
+    
+    chunk_model->optimize_storage();
+    return chunk_model;
+}
+
+void chunk_codec::write_varint(std::vector<uint8>& out, uint32 value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8>(value));
+}
+
+uint32 chunk_codec::read_varint(const uint8*& in, const uint8* end) {
+    uint32 value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (in >= end) break;
+        const uint8 byte = *in++;
+        value |= static_cast<uint32>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("chunk_codec: invalid varint");
+}
+
+std::vector<uint8> chunk_codec::compress(const uint8* data, size_t size) {
+    std::vector<uint8> out;
+    out.reserve(size / 2 + 16);
+    
+    // Последняя позиция каждой 4-байтовой последовательности (+1, 0 - нет)
+    std::vector<uint32> table(size_t(1) << HASH_BITS, 0);
+    
+    size_t anchor = 0;
+    size_t position = 0;
+    while (position + MIN_MATCH <= size) {
+        const uint32 sequence = read32(data + position);
+        uint32& slot = table[hash32(sequence)];
+        const size_t candidate = slot;
+        slot = static_cast<uint32>(position + 1);
+        
+        if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || read32(data + candidate - 1) != sequence) {
+            position++;
+            continue;
+        }
+        
+        const size_t match = candidate - 1;
+        size_t length = MIN_MATCH;
+        while (position + length < size && data[match + length] == data[position + length]) {
+            length++;
+        }
+        
+        // Токен: длина литералов и длина совпадения по 4 бита
+        const size_t literals = position - anchor;
+        const size_t extra = length - MIN_MATCH;
+        out.push_back(static_cast<uint8>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(extra, 15)));
+        if (literals >= 15) write_length(out, literals - 15);
+        out.insert(out.end(), data + anchor, data + position);
+        
+        const size_t offset = position - match;
+        out.push_back(static_cast<uint8>(offset));
+        out.push_back(static_cast<uint8>(offset >> 8));
+        if (extra >= 15) write_length(out, extra - 15);
+        
+        position += length;
+        anchor = position;
+    }
+    
+    // Последняя последовательность - только литералы
+    const size_t literals = size - anchor;
+    out.push_back(static_cast<uint8>(std::min<size_t>(literals, 15) << 4));
+    if (literals >= 15) write_length(out, literals - 15);
+    out.insert(out.end(), data + anchor, data + size);
+    return out;
+}
+
+std::vector<uint8> chunk_codec::decompress(const uint8* data, size_t size, size_t decompressed_size) {
+    std::vector<uint8> out;
+    out.reserve(decompressed_size);
+    
+    const uint8* in = data;
+    const uint8* end = data + size;
+    while (in < end) {
+        const uint8 token = *in++;
+        
+        size_t literals = token >> 4;
+        if (literals == 15) literals += read_length(in, end);
+        if (literals > static_cast<size_t>(end - in) || out.size() + literals > decompressed_size) {
+            throw std::runtime_error("chunk_codec: invalid literals");
+        }
+        out.insert(out.end(), in, in + literals);
+        in += literals;
+        
+        // Последняя последовательность не содержит совпадения
+        if (in == end) break;
+        
+        if (end - in < 2) throw std::runtime_error("chunk_codec: truncated data");
+        const size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        
+        size_t length = (token & 15);
+        if (length == 15) length += read_length(in, end);
+        length += MIN_MATCH;
+        if (offset == 0 || offset > out.size() || out.size() + length > decompressed_size) {
+            throw std::runtime_error("chunk_codec: invalid match");
+        }
+        
+        // Совпадение может перекрывать само себя - копируем побайтно
+        size_t from = out.size() - offset;
+        for (size_t i = 0; i < length; i++) {
+            out.push_back(out[from + i]);
+        }
+    }
+    
+    if (out.size() != decompressed_size) {
+        throw std::runtime_error("chunk_codec: size mismatch");
+    }
+    return out;
+}
+
+} // namespace voxel
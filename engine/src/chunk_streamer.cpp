@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <voxel/chunk_streamer.h>
+#include <voxel/world.h>
+#include <voxel/world_storage.h>
+
+namespace voxel {
+
+chunk_streamer::chunk_streamer(std::shared_ptr<world> world, generator generate, size_t thread_count)
+    : world_(std::move(world)), generate_(std::move(generate)) {
+    if (thread_count == 0) {
+        thread_count = std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+    }
+    for (size_t i = 0; i < thread_count; i++) {
+        threads_.emplace_back(&chunk_streamer::worker_function, this);
+    }
+}
+
+chunk_streamer::~chunk_streamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        queue_.clear();
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void chunk_streamer::set_radius(int load_radius, int unload_radius) {
+    load_radius_ = std::max(0, load_radius);
+    unload_radius_ = std::max(load_radius_, unload_radius);
+    refresh_ = true;
+}
+
+void chunk_streamer::set_cold_radius(int radius) {
+    cold_radius_ = std::max(0, radius);
+    refresh_ = true;
+}
+
+void chunk_streamer::set_storage(std::shared_ptr<world_storage> storage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    storage_ = std::move(storage);
+}
+
+void chunk_streamer::set_height_range(int min_chunk_y, int max_chunk_y) {
+    min_chunk_y_ = min_chunk_y;
+    max_chunk_y_ = std::max(min_chunk_y, max_chunk_y);
+    refresh_ = true;
+}
+
+void chunk_streamer::update(const vec3f& camera_position) {
+    const chunk_coord center = block_to_chunk(
+        static_cast<int>(std::floor(camera_position.x)),
+        static_cast<int>(std::floor(camera_position.y)),
+        static_cast<int>(std::floor(camera_position.z))
+    );
+    if (center != center_) {
+        center_ = center;
+        refresh_ = true;
+    }
+    
+    integrate_generated();
+    
+    if (refresh_) {
+        refresh_ = false;
+        evict_distant();
+        update_cold_chunks();
+        request_missing();
+    }
+}
+
+bool chunk_streamer::in_radius(const chunk_coord& coord, int radius) const {
+    const chunk_coord d = coord - center_;
+    return d.x * d.x + d.y * d.y + d.z * d.z <= radius * radius;
+}
+
+void chunk_streamer::request_missing() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    // Очередь упорядочена по старому центру - сбрасываем не начатые задачи
+    for (const chunk_coord& coord : queue_) {
+        requested_.erase(coord);
+    }
+    queue_.clear();
+    
+    std::vector<chunk_coord> missing;
+    const int y_begin = std::max(center_.y - load_radius_, min_chunk_y_);
+    const int y_end = std::min(center_.y + load_radius_, max_chunk_y_);
+    for (int z = center_.z - load_radius_; z <= center_.z + load_radius_; z++) {
+        for (int y = y_begin; y <= y_end; y++) {
+            for (int x = center_.x - load_radius_; x <= center_.x + load_radius_; x++) {
+                const chunk_coord coord(x, y, z);
+                if (!in_radius(coord, load_radius_)) continue;
+                if (resident_.count(coord) || requested_.count(coord)) continue;
+                missing.push_back(coord);
+            }
+        }
+    }
+    
+    // Ближние чанки - первыми
+    std::sort(missing.begin(), missing.end(), [this](const chunk_coord& a, const chunk_coord& b) {
+        const chunk_coord da = a - center_, db = b - center_;
+        return da.x * da.x + da.y * da.y + da.z * da.z < db.x * db.x + db.y * db.y + db.z * db.z;
+    });
+    for (const chunk_coord& coord : missing) {
+        queue_.push_back(coord);
+        requested_.insert(coord);
+    }
+    cv_.notify_all();
+}
+
+void chunk_streamer::integrate_generated() {
+    std::vector<generated_chunk> completed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        completed.swap(completed_);
+    }
+    
+    for (auto& generated : completed) {
+        requested_.erase(generated.coord);
+        
+        // Камера ушла, пока чанк генерировался
+        if (!in_radius(generated.coord, unload_radius_)) continue;
+        
+        // Не загруженный чанк не становится резидентным: его запросят снова при смене центра
+        if (generated.failed) continue;
+        
+        resident_.insert(generated.coord);
+        
+        // Чанк создан правкой (set_block), пока шла загрузка - правка не затирается
+        if (world_->get_chunk(generated.coord)) continue;
+        
+        if (generated.has_content) {
+            world_->insert_chunk(generated.coord, std::move(generated.pmodel));
+        }
+    }
+}
+
+void chunk_streamer::evict_distant() {
+    std::shared_ptr<world_storage> storage;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        storage = storage_;
+    }
+    
+    std::vector<chunk_snapshot> unsaved;
+    for (auto it = resident_.begin(); it != resident_.end();) {
+        if (in_radius(*it, unload_radius_)) {
+            ++it;
+            continue;
+        }
+        
+        // Модель выгружаемого чанка больше не меняется - копия не нужна
+        auto pchunk = world_->get_chunk(*it);
+        if (storage && pchunk && pchunk->save_dirty) {
+            unsaved.emplace_back(*it, world_->get_chunk_model(*it));
+        }
+        world_->remove_chunk(*it);
+        it = resident_.erase(it);
+    }
+    
+    if (storage) {
+        storage->save_chunks_async(std::move(unsaved));
+    }
+}
+
+void chunk_streamer::update_cold_chunks() {
+    if (cold_radius_ == 0) return;
+    
+    // Чанк, ожидающий меш, не сжимается - повторим при следующей смене центра
+    for (const chunk_coord& coord : resident_) {
+        world_->set_chunk_cold(coord, !in_radius(coord, cold_radius_));
+    }
+}
+
+void chunk_streamer::worker_function() {
+    while (true) {
+        chunk_coord coord;
+        std::shared_ptr<world_storage> storage;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            
+            coord = queue_.front();
+            queue_.pop_front();
+            storage = storage_;
+        }
+        
+        std::shared_ptr<model> pmodel;
+        bool has_content = false;
+        bool failed = false;
+        try {
+            // Сохраненный чанк загружается вместо генерации
+            if (storage) {
+                pmodel = storage->load_chunk(coord);
+                has_content = pmodel != nullptr;
+            }
+            if (!pmodel) {
+                pmodel = std::make_shared<model>(CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, model_storage::sparse);
+                has_content = generate_(coord, *pmodel);
+                if (has_content) {
+                    pmodel->optimize_storage();
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Ошибка загрузки или генерации чанка (" << coord.x << ", " << coord.y << ", " << coord.z << "): " << e.what() << std::endl;
+            has_content = false;
+            failed = true;
+        }
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        completed_.push_back({coord, has_content ? std::move(pmodel) : nullptr, has_content, failed});
+    }
+}
+
+} // namespace voxel
@@ -0,0 +1,165 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include <voxel/command_recorder.h>
+#include <voxel/vulkan_context.h>
+
+namespace voxel {
+
+command_recorder::command_recorder(std::shared_ptr<vulkan_context> context, uint32 frame_count, size_t thread_count)
+    : context_(std::move(context)) {
+    if (thread_count == 0) {
+        thread_count = default_thread_count();
+    }
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex = context_->get_queue_families().graphics_family.value();
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    for (size_t i = 0; i < thread_count; i++) {
+        auto w = std::make_unique<worker>();
+        w->frames.resize(frame_count);
+        for (frame_pool& frame : w->frames) {
+            if (vkCreateCommandPool(context_->get_device(), &pool_info, nullptr, &frame.pool) != VK_SUCCESS) {
+                // Потоки еще не запущены: освобождаем уже созданные пулы
+                workers_.push_back(std::move(w));
+                for (auto& created : workers_) {
+                    for (frame_pool& created_frame : created->frames) {
+                        if (created_frame.pool != VK_NULL_HANDLE) {
+                            vkDestroyCommandPool(context_->get_device(), created_frame.pool, nullptr);
+                        }
+                    }
+                }
+                throw std::runtime_error("Failed to create recording command pool");
+            }
+        }
+        workers_.push_back(std::move(w));
+    }
+
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i]->thread = std::thread(&command_recorder::worker_function, this, i);
+    }
+}
+
+command_recorder::~command_recorder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_cv_.notify_all();
+
+    for (auto& w : workers_) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+        // Буферы освобождаются вместе с пулом
+        for (frame_pool& frame : w->frames) {
+            vkDestroyCommandPool(context_->get_device(), frame.pool, nullptr);
+        }
+    }
+}
+
+size_t command_recorder::default_thread_count() {
+    return std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MAX_DEFAULT_THREADS);
+}
+
+const std::vector<VkCommandBuffer>& command_recorder::record(
+    uint32 frame,
+    const VkCommandBufferInheritanceInfo& inheritance,
+    size_t range_count,
+    const record_function& record_range
+) {
+    results_.assign(range_count, VK_NULL_HANDLE);
+
+    // Пулы кадра сбрасываются каждым потоком, даже без участков
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_frame_ = frame;
+        job_inheritance_ = &inheritance;
+        job_range_count_ = range_count;
+        job_record_ = &record_range;
+        active_ = workers_.size();
+        job_++;
+    }
+    start_cv_.notify_all();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return active_ == 0; });
+    }
+
+    for (auto& w : workers_) {
+        if (w->error) {
+            std::exception_ptr error = w->error;
+            w->error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+    return results_;
+}
+
+void command_recorder::worker_function(size_t index) {
+    worker& self = *workers_[index];
+    VkDevice device = context_->get_device();
+    uint64 seen_job = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [this, seen_job] { return stopping_ || job_ != seen_job; });
+            if (stopping_) return;
+            seen_job = job_;
+        }
+
+        try {
+            frame_pool& frame = self.frames[job_frame_];
+            vkResetCommandPool(device, frame.pool, 0);
+
+            size_t used = 0;
+            for (size_t range = index; range < job_range_count_; range += workers_.size()) {
+                if (used == frame.buffers.size()) {
+                    VkCommandBufferAllocateInfo alloc_info{};
+                    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                    alloc_info.commandPool = frame.pool;
+                    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                    alloc_info.commandBufferCount = 1;
+
+                    VkCommandBuffer command_buffer;
+                    if (vkAllocateCommandBuffers(device, &alloc_info, &command_buffer) != VK_SUCCESS) {
+                        throw std::runtime_error("Failed to allocate secondary command buffer");
+                    }
+                    frame.buffers.push_back(command_buffer);
+                }
+                VkCommandBuffer command_buffer = frame.buffers[used++];
+
+                VkCommandBufferBeginInfo begin_info{};
+                begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                begin_info.pInheritanceInfo = job_inheritance_;
+
+                if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to begin secondary command buffer");
+                }
+                (*job_record_)(command_buffer, range);
+                if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to record secondary command buffer");
+                }
+
+                // Каждый участок пишет только свой элемент
+                results_[range] = command_buffer;
+            }
+        } catch (...) {
+            self.error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_ == 0) {
+                done_cv_.notify_one();
+            }
+        }
+    }
+}
+
+} // namespace voxel
@@ -10,6 +10,7 @@
 #include <voxel/game_logic.h>
 #include <voxel/input.h>
 #include <voxel/world.h>
+#include <voxel/world_storage.h>
 
 namespace voxel {
 
@@ -20,6 +21,7 @@ engine::engine(int width, int height, std::string_view title) {
     renderer_ = std::make_shared<renderer>(vulkan_context_, window_);
     camera_ = std::make_shared<camera>(45.0f, static_cast<float>(width) / height);
     world_ = std::make_shared<world>(vulkan_context_);
+    world_->set_camera(camera_);
     
     // Создаем пустую game_logic по умолчанию
     game_logic_ = std::make_unique<game_logic>();
@@ -67,6 +69,12 @@ void engine::shutdown() {
     // Ожидание завершения операций GPU
     renderer_->wait_idle();
     
+    // Сохранение измененных чанков
+    if (world_storage_) {
+        world_storage_->save(*world_);
+        world_storage_->flush();
+    }
+    
     std::cout << "Ресурсы очищены" << std::endl;
 }
 
@@ -98,6 +106,11 @@ void engine::update(float delta_time) {
     // Обновление мешей мира (асинхронная генерация)
     world_->update_meshes();
     
+    // Автосохранение (запись в фоновом потоке)
+    if (world_storage_) {
+        world_storage_->update(*world_);
+    }
+    
     // Обновление игровой логики
     game_logic_->update(delta_time);
 }
@@ -0,0 +1,94 @@
+#include <cmath>
+
+#include <voxel/frustum.h>
+
+namespace voxel {
+
+// ================== aabb_batch ==================
+
+void aabb_batch::clear() {
+    center_x.clear(); center_y.clear(); center_z.clear();
+    extent_x.clear(); extent_y.clear(); extent_z.clear();
+}
+
+void aabb_batch::reserve(size_t count) {
+    center_x.reserve(count); center_y.reserve(count); center_z.reserve(count);
+    extent_x.reserve(count); extent_y.reserve(count); extent_z.reserve(count);
+}
+
+void aabb_batch::push_back(const aabb& box) {
+    const vec3f center = box.center();
+    const vec3f extent = box.extent();
+    center_x.push_back(center.x); center_y.push_back(center.y); center_z.push_back(center.z);
+    extent_x.push_back(extent.x); extent_y.push_back(extent.y); extent_z.push_back(extent.z);
+}
+
+// ================== frustum ==================
+
+frustum::frustum(const mat4f& m) {
+    // Метод Грибба-Хартманна: clip = p * m, столбец j дает компоненту clip_j.
+    // Ближняя плоскость -w <= z подходит и для глубины [0, 1]: отсечение
+    // только консервативнее
+    auto column = [&m](int j) {
+        return plane{m(0, j), m(1, j), m(2, j), m(3, j)};
+    };
+    const plane cx = column(0), cy = column(1), cz = column(2), cw = column(3);
+
+    planes_[0] = {cw.x + cx.x, cw.y + cx.y, cw.z + cx.z, cw.w + cx.w};
+    planes_[1] = {cw.x - cx.x, cw.y - cx.y, cw.z - cx.z, cw.w - cx.w};
+    planes_[2] = {cw.x + cy.x, cw.y + cy.y, cw.z + cy.z, cw.w + cy.w};
+    planes_[3] = {cw.x - cy.x, cw.y - cy.y, cw.z - cy.z, cw.w - cy.w};
+    planes_[4] = {cw.x + cz.x, cw.y + cz.y, cw.z + cz.z, cw.w + cz.w};
+    planes_[5] = {cw.x - cz.x, cw.y - cz.y, cw.z - cz.z, cw.w - cz.w};
+
+    for (plane& p : planes_) {
+        const float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+        if (length > 0.0f) {
+            p.x /= length; p.y /= length; p.z /= length; p.w /= length;
+        }
+    }
+}
+
+bool frustum::intersects(const aabb& box) const {
+    const vec3f c = box.center();
+    const vec3f e = box.extent();
+    for (const plane& p : planes_) {
+        // Расстояние от центра плюс проекция полуразмера на нормаль
+        const float distance = p.x * c.x + p.y * c.y + p.z * c.z + p.w +
+                               std::abs(p.x) * e.x + std::abs(p.y) * e.y + std::abs(p.z) * e.z;
+        if (distance < 0.0f) return false;
+    }
+    return true;
+}
+
+size_t frustum::test(const aabb_batch& boxes, uint8* visible) const {
+    const size_t count = boxes.size();
+    const float* cx = boxes.center_x.data();
+    const float* cy = boxes.center_y.data();
+    const float* cz = boxes.center_z.data();
+    const float* ex = boxes.extent_x.data();
+    const float* ey = boxes.extent_y.data();
+    const float* ez = boxes.extent_z.data();
+
+    for (size_t i = 0; i < count; i++) {
+        visible[i] = 1;
+    }
+
+    // Плоскость за плоскостью по всем AABB: цикл без ветвлений векторизуется
+    for (const plane& p : planes_) {
+        const float ax = std::abs(p.x), ay = std::abs(p.y), az = std::abs(p.z);
+        for (size_t i = 0; i < count; i++) {
+            const float distance = p.x * cx[i] + p.y * cy[i] + p.z * cz[i] + p.w +
+                                   ax * ex[i] + ay * ey[i] + az * ez[i];
+            visible[i] &= static_cast<uint8>(distance >= 0.0f);
+        }
+    }
+
+    size_t visible_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        visible_count += visible[i];
+    }
+    return visible_count;
+}
+
+} // namespace voxel
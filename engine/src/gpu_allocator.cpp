@@ -0,0 +1,356 @@
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+
+#include <voxel/gpu_allocator.h>
+
+namespace voxel {
+
+namespace {
+    inline VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+gpu_allocator::gpu_allocator(VkDevice device, VkPhysicalDevice physical_device, VkDeviceSize block_size)
+    : device_(device), block_size_(block_size) {
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    buffer_image_granularity_ = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+}
+
+gpu_allocator::~gpu_allocator() {
+    // Участки, не возвращенные владельцами, освобождаются вместе с блоками
+    for (auto& block : blocks_) {
+        if (block->mapped) {
+            vkUnmapMemory(device_, block->memory);
+        }
+        vkFreeMemory(device_, block->memory, nullptr);
+    }
+    blocks_.clear();
+}
+
+gpu_allocation gpu_allocator::allocate(
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties,
+    void* user_data
+) {
+    const uint32 memory_type = find_memory_type(requirements.memoryTypeBits, properties);
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+    const bool host_visible = (memory_properties_.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+    // Крупный ресурс - отдельная память, чтобы не дробить блоки
+    if (requirements.size > block_size_ / 2) {
+        VkMemoryAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = requirements.size;
+        alloc_info.memoryTypeIndex = memory_type;
+
+        gpu_allocation result;
+        if (vkAllocateMemory(device_, &alloc_info, nullptr, &result.memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate device memory");
+        }
+        if (host_visible && vkMapMemory(device_, result.memory, 0, VK_WHOLE_SIZE, 0, &result.mapped) != VK_SUCCESS) {
+            vkFreeMemory(device_, result.memory, nullptr);
+            throw std::runtime_error("Failed to map device memory");
+        }
+        result.size = requirements.size;
+        result.alignment = alignment;
+        result.user_data = user_data;
+        result.memory_type = memory_type;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        dedicated_count_++;
+        dedicated_bytes_ += requirements.size;
+        return result;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    gpu_allocation result;
+    for (auto& block : blocks_) {
+        if (block->memory_type == memory_type &&
+            try_allocate_from(*block, requirements.size, alignment, user_data, result)) {
+            return result;
+        }
+    }
+
+    gpu_memory_block& block = create_block(memory_type);
+    if (!try_allocate_from(block, requirements.size, alignment, user_data, result)) {
+        throw std::runtime_error("gpu_allocator: allocation does not fit into a new block");
+    }
+    return result;
+}
+
+gpu_allocation gpu_allocator::allocate_image(VkImage image, VkMemoryPropertyFlags properties) {
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(device_, image, &requirements);
+    requirements.alignment = std::max(requirements.alignment, buffer_image_granularity_);
+    requirements.size = align_up(requirements.size, buffer_image_granularity_);
+
+    gpu_allocation allocation = allocate(requirements, properties);
+    if (vkBindImageMemory(device_, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+        free(allocation);
+        throw std::runtime_error("Failed to bind image memory");
+    }
+    return allocation;
+}
+
+void gpu_allocator::free(gpu_allocation& allocation) {
+    if (!allocation) return;
+
+    if (!allocation.block) {
+        if (allocation.mapped) {
+            vkUnmapMemory(device_, allocation.memory);
+        }
+        vkFreeMemory(device_, allocation.memory, nullptr);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        dedicated_count_--;
+        dedicated_bytes_ -= allocation.size;
+        allocation = gpu_allocation();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    gpu_memory_block& block = *allocation.block;
+    block.used.erase(allocation.offset);
+    block.used_bytes -= allocation.size;
+    release_range(block, allocation.offset, allocation.size);
+
+    // Один пустой блок типа оставляем в запасе, чтобы не выделять его заново
+    if (block.used.empty()) {
+        const bool has_spare = std::any_of(blocks_.begin(), blocks_.end(), [&block](const auto& other) {
+            return other.get() != &block && other->memory_type == block.memory_type && other->used.empty();
+        });
+        if (has_spare) {
+            destroy_block(block);
+        }
+    }
+
+    allocation = gpu_allocation();
+}
+
+size_t gpu_allocator::defragment(
+    const std::function<bool(const gpu_allocation& from, const gpu_allocation& to)>& move,
+    size_t max_moves
+) {
+    // Кандидаты собираются под блокировкой, move вызывается без неё:
+    // владелец создает новые ресурсы через этот же распределитель
+    std::vector<gpu_allocation> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::vector<gpu_memory_block*> sources;
+        for (auto& block : blocks_) {
+            if (!block->used.empty()) sources.push_back(block.get());
+        }
+        std::sort(sources.begin(), sources.end(), [](const gpu_memory_block* a, const gpu_memory_block* b) {
+            return a->used_bytes < b->used_bytes;
+        });
+
+        // Самые пустые блоки - первыми: их проще освободить целиком
+        for (gpu_memory_block* block : sources) {
+            for (const auto& [offset, allocation] : block->used) {
+                if (allocation.user_data) candidates.push_back(allocation);
+            }
+        }
+    }
+
+    size_t moves = 0;
+    for (gpu_allocation& from : candidates) {
+        if (moves >= max_moves) break;
+
+        gpu_allocation to;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // Участок мог быть освобожден владельцем, а блок - удален
+            const bool alive = std::any_of(blocks_.begin(), blocks_.end(), [&from](const auto& block) {
+                return block.get() == from.block && block->used.count(from.offset) != 0;
+            });
+            if (!alive) continue;
+
+            // Переносим только в более заполненные блоки того же типа
+            for (auto& block : blocks_) {
+                if (block.get() == from.block || block->memory_type != from.memory_type ||
+                    block->used_bytes < from.block->used_bytes) {
+                    continue;
+                }
+                if (try_allocate_from(*block, from.size, from.alignment, from.user_data, to)) break;
+            }
+        }
+        if (!to) continue;
+
+        if (move(from, to)) {
+            free(from);
+            moves++;
+        } else {
+            free(to);
+        }
+    }
+
+    release_empty_blocks();
+    return moves;
+}
+
+void gpu_allocator::release_empty_blocks() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (size_t i = blocks_.size(); i-- > 0;) {
+        if (blocks_[i]->used.empty()) {
+            destroy_block(*blocks_[i]);
+        }
+    }
+}
+
+gpu_allocator_stats gpu_allocator::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    gpu_allocator_stats stats;
+    stats.block_count = blocks_.size();
+    stats.dedicated_count = dedicated_count_;
+    stats.allocation_count = dedicated_count_;
+    stats.reserved_bytes = dedicated_bytes_;
+    stats.used_bytes = dedicated_bytes_;
+
+    for (const auto& block : blocks_) {
+        stats.allocation_count += block->used.size();
+        stats.reserved_bytes += block->size;
+        stats.used_bytes += block->used_bytes;
+        stats.free_range_count += block->free_by_offset.size();
+        if (!block->free_by_size.empty()) {
+            stats.largest_free_range = std::max(stats.largest_free_range, block->free_by_size.rbegin()->first);
+        }
+    }
+    return stats;
+}
+
+uint32 gpu_allocator::find_memory_type(uint32 type_filter, VkMemoryPropertyFlags properties) const {
+    for (uint32 i = 0; i < memory_properties_.memoryTypeCount; i++) {
+        if ((type_filter & (1 << i)) && (memory_properties_.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type");
+}
+
+bool gpu_allocator::try_allocate_from(
+    gpu_memory_block& block,
+    VkDeviceSize size,
+    VkDeviceSize alignment,
+    void* user_data,
+    gpu_allocation& result
+) {
+    // Наименьший подходящий промежуток; выравнивание может потребовать следующего
+    for (auto it = block.free_by_size.lower_bound(size); it != block.free_by_size.end(); ++it) {
+        const VkDeviceSize range_size = it->first;
+        const VkDeviceSize range_offset = it->second;
+        const VkDeviceSize aligned = align_up(range_offset, alignment);
+        const VkDeviceSize padding = aligned - range_offset;
+        if (padding + size > range_size) continue;
+
+        remove_free_range(block, range_offset, range_size);
+        if (padding > 0) {
+            add_free_range(block, range_offset, padding);
+        }
+        if (range_size > padding + size) {
+            add_free_range(block, aligned + size, range_size - padding - size);
+        }
+
+        result.memory = block.memory;
+        result.offset = aligned;
+        result.size = size;
+        result.alignment = alignment;
+        result.mapped = block.mapped ? static_cast<char*>(block.mapped) + aligned : nullptr;
+        result.user_data = user_data;
+        result.memory_type = block.memory_type;
+        result.block = &block;
+
+        block.used[aligned] = result;
+        block.used_bytes += size;
+        return true;
+    }
+    return false;
+}
+
+void gpu_allocator::add_free_range(gpu_memory_block& block, VkDeviceSize offset, VkDeviceSize size) {
+    block.free_by_offset[offset] = size;
+    block.free_by_size.emplace(size, offset);
+}
+
+void gpu_allocator::remove_free_range(gpu_memory_block& block, VkDeviceSize offset, VkDeviceSize size) {
+    block.free_by_offset.erase(offset);
+    auto range = block.free_by_size.equal_range(size);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == offset) {
+            block.free_by_size.erase(it);
+            break;
+        }
+    }
+}
+
+void gpu_allocator::release_range(gpu_memory_block& block, VkDeviceSize offset, VkDeviceSize size) {
+    // Сливаем с соседними свободными промежутками
+    auto next = block.free_by_offset.lower_bound(offset);
+    if (next != block.free_by_offset.end() && next->first == offset + size) {
+        const VkDeviceSize next_size = next->second;
+        remove_free_range(block, offset + size, next_size);
+        size += next_size;
+        next = block.free_by_offset.lower_bound(offset);
+    }
+    if (next != block.free_by_offset.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            const VkDeviceSize prev_offset = prev->first;
+            const VkDeviceSize prev_size = prev->second;
+            remove_free_range(block, prev_offset, prev_size);
+            offset = prev_offset;
+            size += prev_size;
+        }
+    }
+    add_free_range(block, offset, size);
+}
+
+gpu_memory_block& gpu_allocator::create_block(uint32 memory_type) {
+    auto block = std::make_unique<gpu_memory_block>();
+    block->size = block_size_;
+    block->memory_type = memory_type;
+
+    VkMemoryAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = block->size;
+    alloc_info.memoryTypeIndex = memory_type;
+
+    if (vkAllocateMemory(device_, &alloc_info, nullptr, &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate device memory block");
+    }
+
+    if (memory_properties_.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(device_, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+            vkFreeMemory(device_, block->memory, nullptr);
+            throw std::runtime_error("Failed to map device memory block");
+        }
+    }
+
+    add_free_range(*block, 0, block->size);
+    blocks_.push_back(std::move(block));
+    return *blocks_.back();
+}
+
+void gpu_allocator::destroy_block(gpu_memory_block& block) {
+    if (block.mapped) {
+        vkUnmapMemory(device_, block.memory);
+    }
+    vkFreeMemory(device_, block.memory, nullptr);
+
+    blocks_.erase(std::remove_if(blocks_.begin(), blocks_.end(), [&block](const auto& other) {
+        return other.get() == &block;
+    }), blocks_.end());
+}
+
+} // namespace voxel
@@ -0,0 +1,330 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include <voxel/gpu_culler.h>
+#include <voxel/vulkan_context.h>
+#include <voxel/shader.h>
+#include <voxel/hiz_pyramid.h>
+
+namespace voxel {
+
+gpu_culler::gpu_culler(std::shared_ptr<vulkan_context> context, uint32 frame_count, uint32 max_draw_count, const hiz_pyramid& pyramid)
+    : context_(std::move(context)), pyramid_(&pyramid), set_layout_(VK_NULL_HANDLE), pipeline_layout_(VK_NULL_HANDLE),
+      pipeline_(VK_NULL_HANDLE), descriptor_pool_(VK_NULL_HANDLE), max_draw_count_(std::max<uint32>(max_draw_count, 1)) {
+    if (!context_->get_cmd_draw_indexed_indirect_count()) {
+        throw std::runtime_error("gpu_culler: VK_KHR_draw_indirect_count is not supported");
+    }
+    if (!context_->get_enabled_features().drawIndirectFirstInstance) {
+        throw std::runtime_error("gpu_culler: drawIndirectFirstInstance is not supported");
+    }
+
+    shader_ = std::make_unique<shader>(context_, "shaders/cull_comp.spv", shader_type::COMPUTE);
+    create_pipeline();
+    create_descriptors(frame_count);
+    set_depth_pyramid(pyramid);
+}
+
+gpu_culler::~gpu_culler() {
+    VkDevice device = context_->get_device();
+    frames_.clear();
+    if (descriptor_pool_ != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, descriptor_pool_, nullptr);
+    }
+    if (pipeline_ != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, pipeline_, nullptr);
+    }
+    if (pipeline_layout_ != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(device, pipeline_layout_, nullptr);
+    }
+    if (set_layout_ != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, set_layout_, nullptr);
+    }
+}
+
+void gpu_culler::begin(uint32 frame) {
+    frame_ = frame;
+    objects_.clear();
+    transforms_.clear();
+}
+
+void gpu_culler::add(const aabb& bounds, const transform& model_transform, const mesh_arena_range& range) {
+    const vec3f center = bounds.center();
+    const vec3f extent = bounds.extent();
+
+    cull_object object{};
+    object.center[0] = center.x; object.center[1] = center.y; object.center[2] = center.z;
+    object.extent[0] = extent.x; object.extent[1] = extent.y; object.extent[2] = extent.z;
+    object.index_count = range.index_count;
+    object.first_index = range.first_index;
+    object.vertex_offset = static_cast<int32>(range.first_vertex);
+    objects_.push_back(object);
+    
+    object_transform& transform_data = transforms_.emplace_back();
+    std::copy_n(model_transform.get_matrix().ptr(), 16, transform_data.model);
+    std::copy_n(model_transform.get_normal_matrix().ptr(), 12, transform_data.normal);
+}
+
+void gpu_culler::set_depth_pyramid(const hiz_pyramid& pyramid) {
+    pyramid_ = &pyramid;
+
+    VkDescriptorImageInfo image_info{};
+    image_info.sampler = pyramid.get_sampler();
+    image_info.imageView = pyramid.get_view();
+    image_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    for (frame_resources& frame : frames_) {
+        VkWriteDescriptorSet descriptor_write{};
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet = frame.cull_set;
+        descriptor_write.dstBinding = 4;
+        descriptor_write.dstArrayElement = 0;
+        descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.pImageInfo = &image_info;
+        vkUpdateDescriptorSets(context_->get_device(), 1, &descriptor_write, 0, nullptr);
+    }
+}
+
+void gpu_culler::dispatch(VkCommandBuffer command_buffer, const frustum& view_frustum, bool occlusion) {
+    if (objects_.empty()) return;
+
+    // Буферы этого кадра свободны: его fence дождались в begin_frame
+    frame_resources& frame = frames_[frame_];
+    ensure_capacity(frame, objects_.size());
+    frame.objects->copy_from(objects_.data(), objects_.size() * sizeof(cull_object));
+    frame.transforms->copy_from(transforms_.data(), transforms_.size() * sizeof(object_transform));
+
+    // Пирамида построена предыдущим кадром; до первого построения перекрытие не проверяется
+    occlusion_params params{};
+    params.enabled = occlusion && pyramid_->is_built() ? 1 : 0;
+    std::copy_n(pyramid_->get_view_projection().ptr(), 16, params.view_projection);
+    params.depth_size[0] = static_cast<float>(pyramid_->get_depth_extent().width);
+    params.depth_size[1] = static_cast<float>(pyramid_->get_depth_extent().height);
+    params.level_count = pyramid_->get_level_count();
+    frame.occlusion->copy_from(&params, sizeof(params));
+
+    const uint32 chunk_count = get_chunk_count();
+    vkCmdFillBuffer(command_buffer, frame.counts->get_buffer(), 0, chunk_count * sizeof(uint32), 0);
+
+    VkMemoryBarrier fill_barrier{};
+    fill_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fill_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    fill_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &fill_barrier,
+        0, nullptr,
+        0, nullptr
+    );
+
+    cull_push_constants push{};
+    const frustum::plane* planes = view_frustum.get_planes();
+    for (int i = 0; i < 6; i++) {
+        push.planes[i][0] = planes[i].x;
+        push.planes[i][1] = planes[i].y;
+        push.planes[i][2] = planes[i].z;
+        push.planes[i][3] = planes[i].w;
+    }
+    push.object_count = static_cast<uint32>(objects_.size());
+    push.draw_chunk_size = max_draw_count_;
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &frame.cull_set, 0, nullptr);
+    vkCmdPushConstants(command_buffer, pipeline_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(cull_push_constants), &push);
+    vkCmdDispatch(command_buffer, (push.object_count + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    // Команды и счетчики читаются косвенной отрисовкой
+    VkMemoryBarrier cull_barrier{};
+    cull_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0,
+        1, &cull_barrier,
+        0, nullptr,
+        0, nullptr
+    );
+}
+
+void gpu_culler::draw(VkCommandBuffer command_buffer, VkPipelineLayout instanced_layout) {
+    if (objects_.empty()) return;
+
+    frame_resources& frame = frames_[frame_];
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instanced_layout, 1, 1, &frame.transform_set, 0, nullptr);
+
+    // Участок команд на вызов; число команд участка записал шейдер
+    const auto draw_indexed_indirect_count = context_->get_cmd_draw_indexed_indirect_count();
+    const uint32 object_count = static_cast<uint32>(objects_.size());
+    const uint32 chunk_count = get_chunk_count();
+    for (uint32 chunk = 0; chunk < chunk_count; chunk++) {
+        const uint32 first = chunk * max_draw_count_;
+        draw_indexed_indirect_count(
+            command_buffer,
+            frame.commands->get_buffer(),
+            static_cast<VkDeviceSize>(first) * sizeof(VkDrawIndexedIndirectCommand),
+            frame.counts->get_buffer(),
+            static_cast<VkDeviceSize>(chunk) * sizeof(uint32),
+            std::min(max_draw_count_, object_count - first),
+            sizeof(VkDrawIndexedIndirectCommand)
+        );
+    }
+}
+
+uint32 gpu_culler::get_chunk_count() const {
+    const uint64 object_count = objects_.size();
+    return static_cast<uint32>((object_count + max_draw_count_ - 1) / max_draw_count_);
+}
+
+void gpu_culler::create_pipeline() {
+    VkDevice device = context_->get_device();
+
+    // Объекты, команды и счетчики команд, параметры перекрытия и пирамида глубины
+    VkDescriptorSetLayoutBinding bindings[5]{};
+    for (uint32 i = 0; i < 5; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 5;
+    layout_info.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull descriptor set layout!");
+    }
+
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(cull_push_constants);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &set_layout_;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull pipeline layout!");
+    }
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage = shader_->get_stage_info();
+    pipeline_info.layout = pipeline_layout_;
+
+    if (vkCreateComputePipelines(device, context_->get_pipeline_cache(), 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull pipeline!");
+    }
+}
+
+void gpu_culler::create_descriptors(uint32 frame_count) {
+    VkDevice device = context_->get_device();
+
+    // На кадр: набор отсечения (3 storage буфера, uniform буфер, пирамида)
+    // и набор матриц (1 storage буфер)
+    VkDescriptorPoolSize pool_sizes[3]{};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[0].descriptorCount = frame_count * 4;
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    pool_sizes[1].descriptorCount = frame_count;
+    pool_sizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_sizes[2].descriptorCount = frame_count;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 3;
+    pool_info.pPoolSizes = pool_sizes;
+    pool_info.maxSets = frame_count * 2;
+
+    if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create cull descriptor pool!");
+    }
+
+    frames_.resize(frame_count);
+    for (frame_resources& frame : frames_) {
+        VkDescriptorSetLayout layouts[] = {set_layout_, context_->get_quad_set_layout()};
+        VkDescriptorSet sets[2];
+
+        VkDescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.descriptorPool = descriptor_pool_;
+        alloc_info.descriptorSetCount = 2;
+        alloc_info.pSetLayouts = layouts;
+
+        if (vkAllocateDescriptorSets(device, &alloc_info, sets) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate cull descriptor sets!");
+        }
+        frame.cull_set = sets[0];
+        frame.transform_set = sets[1];
+
+        // Размер параметров перекрытия не зависит от числа объектов
+        frame.occlusion = std::make_unique<uniform_buffer>(context_, sizeof(occlusion_params));
+
+        VkDescriptorBufferInfo buffer_info{};
+        buffer_info.buffer = frame.occlusion->get_buffer();
+        buffer_info.offset = 0;
+        buffer_info.range = sizeof(occlusion_params);
+
+        VkWriteDescriptorSet descriptor_write{};
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet = frame.cull_set;
+        descriptor_write.dstBinding = 3;
+        descriptor_write.dstArrayElement = 0;
+        descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.pBufferInfo = &buffer_info;
+        vkUpdateDescriptorSets(device, 1, &descriptor_write, 0, nullptr);
+    }
+}
+
+void gpu_culler::ensure_capacity(frame_resources& frame, size_t object_count) {
+    if (frame.capacity >= object_count) return;
+
+    const size_t capacity = std::max<size_t>({object_count, frame.capacity * 2, 256});
+    frame.objects = std::make_unique<storage_buffer>(context_, capacity * sizeof(cull_object));
+    frame.transforms = std::make_unique<storage_buffer>(context_, capacity * sizeof(object_transform));
+    frame.commands = std::make_unique<indirect_buffer>(
+        context_, capacity * sizeof(VkDrawIndexedIndirectCommand), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+    frame.counts = std::make_unique<indirect_buffer>(
+        context_, capacity * sizeof(uint32), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+    frame.capacity = capacity;
+
+    VkDescriptorBufferInfo buffer_infos[4]{};
+    buffer_infos[0].buffer = frame.objects->get_buffer();
+    buffer_infos[1].buffer = frame.commands->get_buffer();
+    buffer_infos[2].buffer = frame.counts->get_buffer();
+    buffer_infos[3].buffer = frame.transforms->get_buffer();
+
+    VkWriteDescriptorSet descriptor_writes[4]{};
+    for (uint32 i = 0; i < 4; i++) {
+        buffer_infos[i].offset = 0;
+        buffer_infos[i].range = VK_WHOLE_SIZE;
+
+        descriptor_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[i].dstSet = i < 3 ? frame.cull_set : frame.transform_set;
+        descriptor_writes[i].dstBinding = i < 3 ? i : 0;
+        descriptor_writes[i].dstArrayElement = 0;
+        descriptor_writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptor_writes[i].descriptorCount = 1;
+        descriptor_writes[i].pBufferInfo = &buffer_infos[i];
+    }
+
+    vkUpdateDescriptorSets(context_->get_device(), 4, descriptor_writes, 0, nullptr);
+}
+
+} // namespace voxel
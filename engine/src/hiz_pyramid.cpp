@@ -0,0 +1,328 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include <voxel/hiz_pyramid.h>
+#include <voxel/vulkan_context.h>
+#include <voxel/shader.h>
+
+namespace voxel {
+
+hiz_pyramid::hiz_pyramid(std::shared_ptr<vulkan_context> context)
+    : context_(std::move(context)), set_layout_(VK_NULL_HANDLE), pipeline_layout_(VK_NULL_HANDLE),
+      pipeline_(VK_NULL_HANDLE), sampler_(VK_NULL_HANDLE), image_(VK_NULL_HANDLE), view_(VK_NULL_HANDLE),
+      descriptor_pool_(VK_NULL_HANDLE) {
+    shader_ = std::make_unique<shader>(context_, "shaders/hiz_comp.spv", shader_type::COMPUTE);
+    create_pipeline();
+
+    // Тексели читаются texelFetch: фильтрация не используется
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_NEAREST;
+    sampler_info.minFilter = VK_FILTER_NEAREST;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler_info.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(context_->get_device(), &sampler_info, nullptr, &sampler_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth pyramid sampler!");
+    }
+}
+
+hiz_pyramid::~hiz_pyramid() {
+    VkDevice device = context_->get_device();
+    destroy_image();
+    if (sampler_ != VK_NULL_HANDLE) {
+        vkDestroySampler(device, sampler_, nullptr);
+    }
+    if (pipeline_ != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, pipeline_, nullptr);
+    }
+    if (pipeline_layout_ != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(device, pipeline_layout_, nullptr);
+    }
+    if (set_layout_ != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, set_layout_, nullptr);
+    }
+}
+
+void hiz_pyramid::resize(VkImageView depth_view, VkExtent2D depth_extent) {
+    VkDevice device = context_->get_device();
+    destroy_image();
+    depth_extent_ = depth_extent;
+
+    // Уровень 0 - степень двойки, покрывающая половину буфера глубины
+    VkExtent2D extent = {1, 1};
+    while (extent.width * 2 < depth_extent.width) extent.width *= 2;
+    while (extent.height * 2 < depth_extent.height) extent.height *= 2;
+
+    uint32 level_count = 1;
+    for (uint32 size = std::max(extent.width, extent.height); size > 1; size /= 2) {
+        level_count++;
+    }
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = VK_FORMAT_R32_SFLOAT;
+    image_info.extent = {extent.width, extent.height, 1};
+    image_info.mipLevels = level_count;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &image_info, nullptr, &image_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth pyramid image!");
+    }
+
+    allocation_ = context_->get_allocator().allocate_image(image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = image_;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = VK_FORMAT_R32_SFLOAT;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = level_count;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &view_info, nullptr, &view_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth pyramid view!");
+    }
+
+    level_views_.resize(level_count, VK_NULL_HANDLE);
+    level_extents_.resize(level_count);
+    view_info.subresourceRange.levelCount = 1;
+    for (uint32 level = 0; level < level_count; level++) {
+        view_info.subresourceRange.baseMipLevel = level;
+        if (vkCreateImageView(device, &view_info, nullptr, &level_views_[level]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create depth pyramid level view!");
+        }
+        level_extents_[level] = {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+    }
+
+    // На уровень: источник (sampler) и приемник (storage image)
+    VkDescriptorPoolSize pool_sizes[2]{};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pool_sizes[0].descriptorCount = level_count;
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pool_sizes[1].descriptorCount = level_count;
+
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes = pool_sizes;
+    pool_info.maxSets = level_count;
+
+    if (vkCreateDescriptorPool(device, &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth pyramid descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(level_count, set_layout_);
+    level_sets_.resize(level_count);
+
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = descriptor_pool_;
+    alloc_info.descriptorSetCount = level_count;
+    alloc_info.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &alloc_info, level_sets_.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate depth pyramid descriptor sets!");
+    }
+
+    for (uint32 level = 0; level < level_count; level++) {
+        VkDescriptorImageInfo source_info{};
+        source_info.sampler = sampler_;
+        source_info.imageView = level == 0 ? depth_view : level_views_[level - 1];
+        source_info.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo destination_info{};
+        destination_info.imageView = level_views_[level];
+        destination_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet descriptor_writes[2]{};
+        descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[0].dstSet = level_sets_[level];
+        descriptor_writes[0].dstBinding = 0;
+        descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptor_writes[0].descriptorCount = 1;
+        descriptor_writes[0].pImageInfo = &source_info;
+
+        descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[1].dstSet = level_sets_[level];
+        descriptor_writes[1].dstBinding = 1;
+        descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptor_writes[1].descriptorCount = 1;
+        descriptor_writes[1].pImageInfo = &destination_info;
+
+        vkUpdateDescriptorSets(device, 2, descriptor_writes, 0, nullptr);
+    }
+}
+
+void hiz_pyramid::prepare(VkCommandBuffer command_buffer) {
+    if (image_ == VK_NULL_HANDLE || initialized_) return;
+
+    // Все уровни в GENERAL: дескриптор отсечения ссылается на пирамиду и до построения
+    VkImageMemoryBarrier layout_barrier{};
+    layout_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    layout_barrier.srcAccessMask = 0;
+    layout_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    layout_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    layout_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    layout_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    layout_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    layout_barrier.image = image_;
+    layout_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    layout_barrier.subresourceRange.baseMipLevel = 0;
+    layout_barrier.subresourceRange.levelCount = get_level_count();
+    layout_barrier.subresourceRange.baseArrayLayer = 0;
+    layout_barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &layout_barrier
+    );
+    initialized_ = true;
+}
+
+void hiz_pyramid::build(VkCommandBuffer command_buffer, const mat4f& view_projection) {
+    if (image_ == VK_NULL_HANDLE) return;
+
+    if (!initialized_) {
+        prepare(command_buffer);
+    } else {
+        // Отсечение этого кадра уже прочитало пирамиду - перезапись после него
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            0, nullptr
+        );
+    }
+
+    // Каждый уровень читает предыдущий (уровень 0 - буфер глубины)
+    VkMemoryBarrier level_barrier{};
+    level_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    level_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    level_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+    for (uint32 level = 0; level < get_level_count(); level++) {
+        vkCmdBindDescriptorSets(
+            command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &level_sets_[level], 0, nullptr
+        );
+        const VkExtent2D& extent = level_extents_[level];
+        vkCmdDispatch(
+            command_buffer,
+            (extent.width + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+            (extent.height + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+            1
+        );
+
+        // Уровень читает следующий уровень, последний - отсечение следующего кадра
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1, &level_barrier,
+            0, nullptr,
+            0, nullptr
+        );
+    }
+
+    view_projection_ = view_projection;
+    built_ = true;
+}
+
+void hiz_pyramid::create_pipeline() {
+    VkDevice device = context_->get_device();
+
+    // Источник и уровень-приемник
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 2;
+    layout_info.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layout_info, nullptr, &set_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth pyramid descriptor set layout!");
+    }
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &set_layout_;
+
+    if (vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth pyramid pipeline layout!");
+    }
+
+    VkComputePipelineCreateInfo pipeline_info{};
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.stage = shader_->get_stage_info();
+    pipeline_info.layout = pipeline_layout_;
+
+    if (vkCreateComputePipelines(device, context_->get_pipeline_cache(), 1, &pipeline_info, nullptr, &pipeline_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth pyramid pipeline!");
+    }
+}
+
+void hiz_pyramid::destroy_image() {
+    VkDevice device = context_->get_device();
+
+    // Наборы освобождаются вместе с пулом
+    if (descriptor_pool_ != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, descriptor_pool_, nullptr);
+        descriptor_pool_ = VK_NULL_HANDLE;
+    }
+    level_sets_.clear();
+
+    for (VkImageView level_view : level_views_) {
+        if (level_view != VK_NULL_HANDLE) {
+            vkDestroyImageView(device, level_view, nullptr);
+        }
+    }
+    level_views_.clear();
+    level_extents_.clear();
+
+    if (view_ != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, view_, nullptr);
+        view_ = VK_NULL_HANDLE;
+    }
+    if (image_ != VK_NULL_HANDLE) {
+        vkDestroyImage(device, image_, nullptr);
+        image_ = VK_NULL_HANDLE;
+    }
+    if (allocation_) {
+        context_->get_allocator().free(allocation_);
+    }
+
+    initialized_ = false;
+    built_ = false;
+}
+
+} // namespace voxel
@@ -141,5 +141,31 @@ mat4f inverse_matrix(const mat4f& matrix) {
     return result;
 }
 
+mat4f normal_matrix(const mat4f& model) {
+    // Строки обратной транспонированной - векторные произведения строк,
+    // деленные на определитель (присоединенная матрица)
+    const vec3f r0(model(0, 0), model(0, 1), model(0, 2));
+    const vec3f r1(model(1, 0), model(1, 1), model(1, 2));
+    const vec3f r2(model(2, 0), model(2, 1), model(2, 2));
+    
+    const vec3f c0 = cross(r1, r2);
+    const vec3f c1 = cross(r2, r0);
+    const vec3f c2 = cross(r0, r1);
+    
+    // Вырожденная матрица (нулевой масштаб) - без деления: направление нормали
+    // шейдер все равно нормализует
+    const float det = dot(r0, c0);
+    const float inv_det = det != 0.0f ? 1.0f / det : 1.0f;
+    
+    mat4f result = identity_matrix();
+    const vec3f rows[3] = {c0, c1, c2};
+    for (int i = 0; i < 3; i++) {
+        result(i, 0) = rows[i].x * inv_det;
+        result(i, 1) = rows[i].y * inv_det;
+        result(i, 2) = rows[i].z * inv_det;
+    }
+    return result;
+}
+
 } // namespace math
 } // namespace voxel 
\ No newline at end of file
@@ -1,6 +1,11 @@
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+
 #include <voxel/mesh.h>
 #include <voxel/buffer.h>
 #include <voxel/vulkan_context.h>
+#include <voxel/upload_queue.h>
 
 namespace voxel {
 
@@ -15,35 +20,55 @@ std::vector<VkVertexInputBindingDescription> vertex::get_binding_descriptions()
 }
 
 std::vector<VkVertexInputAttributeDescription> vertex::get_attribute_descriptions() {
-    std::vector<VkVertexInputAttributeDescription> attribute_descriptions(3);
+    std::vector<VkVertexInputAttributeDescription> attribute_descriptions(1);
     
-    // position
+    // data0, data1 - распаковываются в voxel.vert
     attribute_descriptions[0].binding = 0;
     attribute_descriptions[0].location = 0;
-    attribute_descriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attribute_descriptions[0].offset = offsetof(vertex, position);
-    
-    // normal
-    attribute_descriptions[1].binding = 0;
-    attribute_descriptions[1].location = 1;
-    attribute_descriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attribute_descriptions[1].offset = offsetof(vertex, normal);
-    
-    // color
-    attribute_descriptions[2].binding = 0;
-    attribute_descriptions[2].location = 2;
-    attribute_descriptions[2].format = VK_FORMAT_R32_UINT;
-    attribute_descriptions[2].offset = offsetof(vertex, color);
+    attribute_descriptions[0].format = VK_FORMAT_R32G32_UINT;
+    attribute_descriptions[0].offset = offsetof(vertex, data0);
     
     return attribute_descriptions;
 }
 
+namespace {
+    // Координаты вершин упакованы в 10 бит - модель не больше 1023 по каждой оси
+    void check_packable(const model& model) {
+        if (model.width() > vertex::MAX_POSITION ||
+            model.height() > vertex::MAX_POSITION ||
+            model.depth() > vertex::MAX_POSITION) {
+            throw std::runtime_error("mesh generator: model is too large for packed vertices");
+        }
+    }
+}
+
 
 // ================== mesh ==================
 
 mesh::mesh(std::shared_ptr<vulkan_context> context)
-    : context_(context), vertex_buffer_(nullptr), index_buffer_(nullptr), 
-      vertex_count_(0), index_count_(0) {
+    : context_(context), vertex_buffer_(nullptr), index_buffer_(nullptr), quad_buffer_(nullptr),
+      quad_descriptor_pool_(VK_NULL_HANDLE), quad_descriptor_set_(VK_NULL_HANDLE),
+      vertex_count_(0), index_count_(0), quad_count_(0) {
+}
+
+mesh::~mesh() {
+    release_quad_descriptor();
+    if (arena_) {
+        arena_->release(arena_range_);
+    }
+}
+
+mesh::mesh(mesh&& other) noexcept
+    : context_(std::move(other.context_)), vertex_buffer_(std::move(other.vertex_buffer_)),
+      index_buffer_(std::move(other.index_buffer_)), quad_buffer_(std::move(other.quad_buffer_)),
+      quad_descriptor_pool_(other.quad_descriptor_pool_), quad_descriptor_set_(other.quad_descriptor_set_),
+      arena_(std::move(other.arena_)), arena_range_(other.arena_range_),
+      vertex_count_(other.vertex_count_), index_count_(other.index_count_), quad_count_(other.quad_count_) {
+    other.quad_descriptor_pool_ = VK_NULL_HANDLE;
+    other.quad_descriptor_set_ = VK_NULL_HANDLE;
+    other.vertex_count_ = 0;
+    other.index_count_ = 0;
+    other.quad_count_ = 0;
 }
 
 void mesh::set_vertices(const std::vector<vertex>& vertices) {
@@ -60,12 +85,88 @@ void mesh::set_indices(const std::vector<uint32>& indices) {
     }
 }
 
+void mesh::set_quads(const std::vector<quad_record>& quads) {
+    release_quad_descriptor();
+    quad_buffer_.reset();
+    quad_count_ = quads.size();
+    if (quad_count_ == 0) return;
+    
+    quad_buffer_ = std::make_unique<storage_buffer>(context_, quads);
+    create_quad_descriptor();
+}
+
 void mesh::set_mesh_data(const mesh_data& data) {
     set_vertices(data.vertices);
     set_indices(data.indices);
+    set_quads(data.quads);
+}
+
+void mesh::set_mesh_data(const mesh_data& data, upload_queue& uploads) {
+    const VkDeviceSize vertex_bytes = data.vertices.size() * sizeof(vertex);
+    const VkDeviceSize index_bytes = data.indices.size() * sizeof(uint32);
+    const VkDeviceSize quad_bytes = data.quads.size() * sizeof(quad_record);
+    
+    if (arena_) {
+        arena_->release(arena_range_);
+        arena_.reset();
+        arena_range_ = mesh_arena_range();
+    }
+    
+    vertex_count_ = data.vertices.size();
+    if (vertex_count_ > 0) {
+        vertex_buffer_ = std::make_unique<vertex_buffer>(context_, vertex_bytes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        uploads.upload(*vertex_buffer_, data.vertices.data(), vertex_bytes);
+    }
+    
+    index_count_ = data.indices.size();
+    if (index_count_ > 0) {
+        index_buffer_ = std::make_unique<index_buffer>(context_, index_bytes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        uploads.upload(*index_buffer_, data.indices.data(), index_bytes);
+    }
+    
+    release_quad_descriptor();
+    quad_buffer_.reset();
+    quad_count_ = data.quads.size();
+    if (quad_count_ > 0) {
+        quad_buffer_ = std::make_unique<storage_buffer>(context_, quad_bytes, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        uploads.upload(*quad_buffer_, data.quads.data(), quad_bytes);
+        create_quad_descriptor();
+    }
+}
+
+void mesh::set_mesh_data(const mesh_data& data, std::shared_ptr<mesh_arena> arena, upload_queue& uploads) {
+    mesh_arena_range range;
+    if (!arena || !data.quads.empty() ||
+        !arena->allocate(static_cast<uint32>(data.vertices.size()), static_cast<uint32>(data.indices.size()), range)) {
+        set_mesh_data(data, uploads);
+        return;
+    }
+    
+    uploads.upload(
+        arena->get_vertex_buffer(), data.vertices.data(), data.vertices.size() * sizeof(vertex),
+        static_cast<VkDeviceSize>(range.first_vertex) * sizeof(vertex)
+    );
+    uploads.upload(
+        arena->get_index_buffer(), data.indices.data(), data.indices.size() * sizeof(uint32),
+        static_cast<VkDeviceSize>(range.first_index) * sizeof(uint32)
+    );
+    
+    if (arena_) {
+        arena_->release(arena_range_);
+    }
+    arena_ = std::move(arena);
+    arena_range_ = range;
+    vertex_buffer_.reset();
+    index_buffer_.reset();
+    vertex_count_ = range.vertex_count;
+    index_count_ = range.index_count;
 }
 
 void mesh::bind(VkCommandBuffer command_buffer) {
+    if (arena_) {
+        arena_->bind(command_buffer);
+        return;
+    }
     if (vertex_buffer_) {
         VkBuffer vertex_buffers[] = {vertex_buffer_->get_buffer()};
         VkDeviceSize offsets[] = {0};
@@ -78,13 +179,83 @@ void mesh::bind(VkCommandBuffer command_buffer) {
 
 void mesh::draw(VkCommandBuffer command_buffer) {
     if (vertex_count_ > 0) {
-        vkCmdDraw(command_buffer, static_cast<uint32>(vertex_count_), 1, 0, 0);
+        vkCmdDraw(command_buffer, static_cast<uint32>(vertex_count_), 1, arena_range_.first_vertex, 0);
     }
 }
 
-void mesh::draw_indexed(VkCommandBuffer command_buffer) {
+void mesh::draw_indexed(VkCommandBuffer command_buffer, uint32 instance_count, uint32 first_instance) {
     if (index_count_ > 0) {
-        vkCmdDrawIndexed(command_buffer, static_cast<uint32>(index_count_), 1, 0, 0, 0);
+        vkCmdDrawIndexed(
+            command_buffer, static_cast<uint32>(index_count_), instance_count,
+            arena_range_.first_index, static_cast<int32_t>(arena_range_.first_vertex), first_instance
+        );
+    }
+}
+
+void mesh::bind_quads(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout) {
+    if (quad_descriptor_set_ != VK_NULL_HANDLE) {
+        vkCmdBindDescriptorSets(
+            command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout,
+            QUAD_SET, 1, &quad_descriptor_set_, 0, nullptr
+        );
+    }
+}
+
+void mesh::draw_quads(VkCommandBuffer command_buffer) {
+    if (quad_count_ > 0) {
+        vkCmdDraw(command_buffer, static_cast<uint32>(quad_count_ * 6), 1, 0, 0);
+    }
+}
+
+void mesh::create_quad_descriptor() {
+    // Собственный набор дескрипторов меша, указывающий на его буфер квадов
+    VkDescriptorPoolSize pool_size{};
+    pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = 1;
+    
+    VkDescriptorPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_info.poolSizeCount = 1;
+    pool_info.pPoolSizes = &pool_size;
+    pool_info.maxSets = 1;
+    
+    if (vkCreateDescriptorPool(context_->get_device(), &pool_info, nullptr, &quad_descriptor_pool_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create quad descriptor pool");
+    }
+    
+    VkDescriptorSetLayout layout = context_->get_quad_set_layout();
+    VkDescriptorSetAllocateInfo alloc_info{};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorPool = quad_descriptor_pool_;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &layout;
+    
+    if (vkAllocateDescriptorSets(context_->get_device(), &alloc_info, &quad_descriptor_set_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate quad descriptor set");
+    }
+    
+    VkDescriptorBufferInfo buffer_info{};
+    buffer_info.buffer = quad_buffer_->get_buffer();
+    buffer_info.offset = 0;
+    buffer_info.range = VK_WHOLE_SIZE;
+    
+    VkWriteDescriptorSet descriptor_write{};
+    descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write.dstSet = quad_descriptor_set_;
+    descriptor_write.dstBinding = 0;
+    descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_write.descriptorCount = 1;
+    descriptor_write.pBufferInfo = &buffer_info;
+    
+    vkUpdateDescriptorSets(context_->get_device(), 1, &descriptor_write, 0, nullptr);
+}
+
+void mesh::release_quad_descriptor() {
+    // Набор освобождается вместе с пулом
+    if (quad_descriptor_pool_ != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(context_->get_device(), quad_descriptor_pool_, nullptr);
+        quad_descriptor_pool_ = VK_NULL_HANDLE;
+        quad_descriptor_set_ = VK_NULL_HANDLE;
     }
 }
 
@@ -109,6 +280,7 @@ mesh_data simple_mesh_generator::generate_mesh_data(const std::shared_ptr<model>
     if (!model) {
         return mesh_data();
     }
+    check_packable(*model);
     
     std::vector<vertex> vertices;
     std::vector<uint32> indices;
@@ -143,14 +315,7 @@ void simple_mesh_generator::add_cube_face(
     uint32 color
 ) {
     // Направления граней: 0=+X, 1=-X, 2=+Y, 3=-Y, 4=+Z, 5=-Z
-    static const vec3f face_normals[6] = {
-        vec3f(1, 0, 0),   // +X
-        vec3f(-1, 0, 0),  // -X
-        vec3f(0, 1, 0),   // +Y
-        vec3f(0, -1, 0),  // -Y
-        vec3f(0, 0, 1),   // +Z
-        vec3f(0, 0, -1)   // -Z
-    };
+    // Нормаль восстанавливается в шейдере по направлению грани
     
     // Вершины для каждой грани (4 вершины на грань) - против часовой стрелки относительно нормали
     static const vec3f face_vertices[6][4] = {
@@ -172,12 +337,11 @@ void simple_mesh_generator::add_cube_face(
     static const uint32 face_indices[6] = {0, 1, 2, 2, 3, 0};
     
     uint32 base_vertex = static_cast<uint32>(vertices.size());
-    vec3f normal = face_normals[face_direction];
     
     // Добавляем 4 вершины грани
     for (int i = 0; i < 4; i++) {
         vec3f vertex_pos = position + face_vertices[face_direction][i];
-        vertices.emplace_back(vertex_pos, normal, color);
+        vertices.emplace_back(vertex_pos, face_direction, color);
     }
     
     // Добавляем 6 индексов для двух треугольников
@@ -237,6 +401,7 @@ mesh_data greedy_mesh_generator::generate_mesh_data(const std::shared_ptr<model>
     if (!model) {
         return mesh_data();
     }
+    check_packable(*model);
     
     std::vector<vertex> vertices;
     std::vector<uint32> indices;
@@ -390,15 +555,6 @@ void greedy_mesh_generator::add_quad(
     uint32 color
 ) {
     // Направления граней: 0=+X, 1=-X, 2=+Y, 3=-Y, 4=+Z, 5=-Z
-    static const vec3f face_normals[6] = {
-        vec3f(1, 0, 0),   // +X
-        vec3f(-1, 0, 0),  // -X
-        vec3f(0, 1, 0),   // +Y
-        vec3f(0, -1, 0),  // -Y
-        vec3f(0, 0, 1),   // +Z
-        vec3f(0, 0, -1)   // -Z
-    };
-    
     // Вершины для каждого направления грани - против часовой стрелки относительно нормали
     static const int vertex_indices[6][4] = {
         // +X: (max.x, min.y, min.z), (max.x, min.y, max.z), (max.x, max.y, max.z), (max.x, max.y, min.z)
@@ -428,12 +584,11 @@ void greedy_mesh_generator::add_quad(
     };
     
     uint32 base_vertex = static_cast<uint32>(vertices.size());
-    vec3f normal = face_normals[face_direction];
     
     // Добавляем 4 вершины грани
     for (int i = 0; i < 4; i++) {
         int vertex_idx = vertex_indices[face_direction][i];
-        vertices.emplace_back(cube_vertices[vertex_idx], normal, color);
+        vertices.emplace_back(cube_vertices[vertex_idx], face_direction, color);
     }
     
     // Добавляем 6 индексов для двух треугольников
@@ -468,4 +623,389 @@ bool greedy_mesh_generator::is_face_visible(const std::shared_ptr<model>& model,
     return model->is_empty(nx, ny, nz);
 }
 
-} // namespace voxel 
\ No newline at end of file
+
+// ================== binary_mesh_generator ==================
+
+namespace {
+    // Количество 64-битных слов для хранения заданного числа бит
+    inline int word_count(int bits) {
+        return (bits + 63) / 64;
+    }
+
+    // Раскладка колонок для оси (0=X, 1=Y, 2=Z):
+    // length - длина колонки вдоль оси, (u, v) - координаты плоскости слоя
+    struct axis_layout {
+        int length;
+        int plane_width;
+        int plane_height;
+    };
+
+    axis_layout get_axis_layout(const model& model, int axis) {
+        switch (axis) {
+            case 0:  return {model.width(), model.depth(), model.height()}; // u=z, v=y
+            case 1:  return {model.height(), model.width(), model.depth()}; // u=x, v=z
+            default: return {model.depth(), model.width(), model.height()}; // u=x, v=y
+        }
+    }
+
+    inline bool is_cancelled(const std::atomic<bool>* cancelled) {
+        return cancelled && cancelled->load(std::memory_order_relaxed);
+    }
+
+    // Грань слоя одного цвета: смещение её битовой плоскости в общем пуле
+    struct color_plane {
+        uint32 color;
+        size_t offset;
+    };
+
+    // Отрезок бит [begin, end) внутри одного слова (кирпич не пересекает границу слова)
+    inline uint64 run_mask(int begin, int end) {
+        return ((1ull << (end - begin)) - 1) << (begin & 63);
+    }
+
+    // Колонки занятости разреженной модели: пустые кирпичи пропускаются,
+    // сплошные заполняются отрезками целиком
+    void fill_brick_columns(std::vector<uint64>* columns, const int* words, const model& model, const brick_storage& bricks) {
+        const int width = model.width();
+        const int height = model.height();
+        const int depth = model.depth();
+        
+        for (int bz = 0; bz < bricks.bricks_z(); bz++) {
+            for (int by = 0; by < bricks.bricks_y(); by++) {
+                for (int bx = 0; bx < bricks.bricks_x(); bx++) {
+                    voxel uniform;
+                    const bool is_uniform = bricks.is_brick_uniform(bx, by, bz, uniform);
+                    if (is_uniform && uniform.is_empty()) continue;
+                    
+                    const int x0 = bx << brick_storage::BRICK_SHIFT, x1 = std::min(x0 + brick_storage::BRICK_SIZE, width);
+                    const int y0 = by << brick_storage::BRICK_SHIFT, y1 = std::min(y0 + brick_storage::BRICK_SIZE, height);
+                    const int z0 = bz << brick_storage::BRICK_SHIFT, z1 = std::min(z0 + brick_storage::BRICK_SIZE, depth);
+                    
+                    if (is_uniform) {
+                        const uint64 x_run = run_mask(x0, x1);
+                        const uint64 y_run = run_mask(y0, y1);
+                        const uint64 z_run = run_mask(z0, z1);
+                        for (int z = z0; z < z1; z++)
+                            for (int y = y0; y < y1; y++)
+                                columns[0][(static_cast<size_t>(y) * depth + z) * words[0] + (x0 >> 6)] |= x_run;
+                        for (int z = z0; z < z1; z++)
+                            for (int x = x0; x < x1; x++)
+                                columns[1][(static_cast<size_t>(z) * width + x) * words[1] + (y0 >> 6)] |= y_run;
+                        for (int y = y0; y < y1; y++)
+                            for (int x = x0; x < x1; x++)
+                                columns[2][(static_cast<size_t>(y) * width + x) * words[2] + (z0 >> 6)] |= z_run;
+                        continue;
+                    }
+                    
+                    for (int z = z0; z < z1; z++) {
+                        for (int y = y0; y < y1; y++) {
+                            for (int x = x0; x < x1; x++) {
+                                if (bricks.get(x, y, z).is_empty()) continue;
+                                
+                                columns[0][(static_cast<size_t>(y) * depth + z) * words[0] + (x >> 6)] |= 1ull << (x & 63);
+                                columns[1][(static_cast<size_t>(z) * width + x) * words[1] + (y >> 6)] |= 1ull << (y & 63);
+                                columns[2][(static_cast<size_t>(y) * width + x) * words[2] + (z >> 6)] |= 1ull << (z & 63);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+mesh binary_mesh_generator::generate_from_model(
+    std::shared_ptr<vulkan_context> context,
+    const std::shared_ptr<model>& model
+) {
+    if (!model) {
+        return mesh(context);
+    }
+    
+    mesh_data data = generate_mesh_data(model);
+    
+    mesh result(context);
+    result.set_mesh_data(data);
+    return result;
+}
+
+mesh_data binary_mesh_generator::generate_mesh_data(
+    const std::shared_ptr<model>& model,
+    const std::atomic<bool>* cancelled
+) {
+    return generate(model, nullptr, mesh_format::indexed, cancelled);
+}
+
+mesh_data binary_mesh_generator::generate_mesh_data(
+    const std::shared_ptr<model>& model,
+    const mesh_borders& borders,
+    const std::atomic<bool>* cancelled
+) {
+    return generate(model, &borders, mesh_format::indexed, cancelled);
+}
+
+mesh_data binary_mesh_generator::generate_mesh_data(
+    const std::shared_ptr<model>& model,
+    const mesh_borders* borders,
+    mesh_format format,
+    const std::atomic<bool>* cancelled
+) {
+    return generate(model, borders, format, cancelled);
+}
+
+mesh_data binary_mesh_generator::generate(
+    const std::shared_ptr<model>& model,
+    const mesh_borders* borders,
+    mesh_format format,
+    const std::atomic<bool>* cancelled
+) {
+    if (!model || model->width() <= 0 || model->height() <= 0 || model->depth() <= 0) {
+        return mesh_data();
+    }
+    check_packable(*model);
+    
+    const int width = model->width();
+    const int height = model->height();
+    const int depth = model->depth();
+    
+    // Колонки занятости для каждой оси: бит i колонки = воксел i вдоль оси
+    std::vector<uint64> columns[3];
+    int words[3];
+    for (int axis = 0; axis < 3; axis++) {
+        axis_layout layout = get_axis_layout(*model, axis);
+        words[axis] = word_count(layout.length);
+        columns[axis].assign(
+            static_cast<size_t>(layout.plane_width) * layout.plane_height * words[axis], 0
+        );
+    }
+    
+    // Единственный проход по вокселам модели
+    if (const brick_storage* bricks = model->get_bricks()) {
+        fill_brick_columns(columns, words, *model, *bricks);
+    } else {
+        for (int z = 0; z < depth; z++) {
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    if (model->get_voxel_unchecked(x, y, z).is_empty()) continue;
+                    
+                    columns[0][(static_cast<size_t>(y) * depth + z) * words[0] + (x >> 6)] |= 1ull << (x & 63);
+                    columns[1][(static_cast<size_t>(z) * width + x) * words[1] + (y >> 6)] |= 1ull << (y & 63);
+                    columns[2][(static_cast<size_t>(y) * width + x) * words[2] + (z >> 6)] |= 1ull << (z & 63);
+                }
+            }
+        }
+    }
+    
+    mesh_data data;
+    
+    for (int axis = 0; axis < 3; axis++) {
+        if (is_cancelled(cancelled)) {
+            return mesh_data();
+        }
+        generate_axis_quads(data, format, *model, columns[axis], axis, borders, cancelled);
+    }
+    
+    if (is_cancelled(cancelled)) {
+        return mesh_data();
+    }
+    
+    return data;
+}
+
+void binary_mesh_generator::generate_axis_quads(
+    mesh_data& data,
+    mesh_format format,
+    const model& model,
+    const std::vector<uint64>& columns,
+    int axis,
+    const mesh_borders* borders,
+    const std::atomic<bool>* cancelled
+) {
+    const axis_layout layout = get_axis_layout(model, axis);
+    const int words = word_count(layout.length);
+    const int tiles = word_count(layout.plane_width);
+    const size_t plane_size = static_cast<size_t>(layout.plane_height) * tiles;
+    
+    // Для каждого слоя - список плоскостей граней по цветам
+    std::vector<std::vector<color_plane>> layers(layout.length);
+    std::vector<uint64> pool;
+    
+    // side 0 - положительное направление оси, side 1 - отрицательное
+    for (int side = 0; side < 2; side++) {
+        const int face_direction = axis * 2 + side;
+        if (is_cancelled(cancelled)) return;
+        
+        for (auto& layer_planes : layers) {
+            layer_planes.clear();
+        }
+        pool.clear();
+        
+        for (int v = 0; v < layout.plane_height; v++) {
+            for (int u = 0; u < layout.plane_width; u++) {
+                const uint64* column = &columns[(static_cast<size_t>(v) * layout.plane_width + u) * words];
+                
+                // Воксел соседней модели за крайним слоем колонки
+                const uint64 border = borders && borders->is_solid(face_direction, u, v) ? 1 : 0;
+                
+                for (int w = 0; w < words; w++) {
+                    // Соседи в направлении грани; за границей модели - слой соседа или пустота
+                    uint64 neighbours;
+                    if (side == 0) {
+                        neighbours = (column[w] >> 1) | (w + 1 < words ? column[w + 1] << 63 : border << ((layout.length - 1) & 63));
+                    } else {
+                        neighbours = (column[w] << 1) | (w > 0 ? column[w - 1] >> 63 : border);
+                    }
+                    uint64 faces = column[w] & ~neighbours;
+                    
+                    while (faces) {
+                        const int layer = w * 64 + std::countr_zero(faces);
+                        faces &= faces - 1;
+                        
+                        uint32 color;
+                        switch (axis) {
+                            case 0:  color = model.get_voxel_unchecked(layer, v, u).color; break;
+                            case 1:  color = model.get_voxel_unchecked(u, layer, v).color; break;
+                            default: color = model.get_voxel_unchecked(u, v, layer).color; break;
+                        }
+                        
+                        // Находим (или заводим) плоскость этого цвета в слое
+                        auto& layer_planes = layers[layer];
+                        auto it = std::find_if(layer_planes.begin(), layer_planes.end(),
+                            [color](const color_plane& plane) { return plane.color == color; });
+                        if (it == layer_planes.end()) {
+                            layer_planes.push_back({color, pool.size()});
+                            pool.resize(pool.size() + plane_size, 0);
+                            it = layer_planes.end() - 1;
+                        }
+                        
+                        pool[it->offset + static_cast<size_t>(v) * tiles + (u >> 6)] |= 1ull << (u & 63);
+                    }
+                }
+            }
+        }
+        
+        for (int layer = 0; layer < layout.length; layer++) {
+            for (const auto& plane : layers[layer]) {
+                merge_plane_quads(
+                    data, format, &pool[plane.offset],
+                    layout.plane_width, layout.plane_height,
+                    layer, face_direction, plane.color
+                );
+            }
+        }
+    }
+}
+
+void binary_mesh_generator::merge_plane_quads(
+    mesh_data& data,
+    mesh_format format,
+    uint64* plane,
+    int plane_width,
+    int plane_height,
+    int layer,
+    int face_direction,
+    uint32 color
+) {
+    const int tiles = word_count(plane_width);
+    
+    for (int v = 0; v < plane_height; v++) {
+        for (int t = 0; t < tiles; t++) {
+            uint64& row = plane[static_cast<size_t>(v) * tiles + t];
+            
+            while (row) {
+                // Отрезок подряд идущих граней в строке
+                const int start = std::countr_zero(row);
+                const int run = std::countr_one(row >> start);
+                const uint64 run_mask = (run == 64 ? ~0ull : ((1ull << run) - 1)) << start;
+                row &= ~run_mask;
+                
+                // Растягиваем отрезок по следующим строкам, пока они его покрывают
+                int h = 1;
+                while (v + h < plane_height) {
+                    uint64& next = plane[static_cast<size_t>(v + h) * tiles + t];
+                    if ((next & run_mask) != run_mask) break;
+                    next &= ~run_mask;
+                    h++;
+                }
+                
+                const int u = t * 64 + start;
+                vec3f min_pos, max_pos;
+                switch (face_direction / 2) {
+                    case 0: // X: u=z, v=y
+                        min_pos = vec3f(layer, v, u);
+                        max_pos = vec3f(layer + 1, v + h, u + run);
+                        break;
+                    case 1: // Y: u=x, v=z
+                        min_pos = vec3f(u, layer, v);
+                        max_pos = vec3f(u + run, layer + 1, v + h);
+                        break;
+                    default: // Z: u=x, v=y
+                        min_pos = vec3f(u, v, layer);
+                        max_pos = vec3f(u + run, v + h, layer + 1);
+                        break;
+                }
+                
+                if (format == mesh_format::quads) {
+                    data.quads.emplace_back(min_pos, max_pos, face_direction, color);
+                } else {
+                    greedy_mesh_generator::add_quad(data.vertices, data.indices, min_pos, max_pos, face_direction, color);
+                }
+            }
+        }
+    }
+}
+
+
+// ================== mesh_borders ==================
+
+void mesh_borders::set_face(const model& target, int face_direction, const model& neighbor) {
+    const int axis = face_direction / 2;
+    const axis_layout layout = get_axis_layout(target, axis);
+    
+    // Прилегающий слой соседа: первый для положительной грани, последний для отрицательной
+    int layer = 0;
+    if (face_direction % 2 == 1) {
+        switch (axis) {
+            case 0:  layer = neighbor.width() - 1; break;
+            case 1:  layer = neighbor.height() - 1; break;
+            default: layer = neighbor.depth() - 1; break;
+        }
+    }
+    
+    auto& plane = planes_[face_direction];
+    plane.assign(word_count(layout.plane_width * layout.plane_height), 0);
+    widths_[face_direction] = layout.plane_width;
+    
+    for (int v = 0; v < layout.plane_height; v++) {
+        for (int u = 0; u < layout.plane_width; u++) {
+            bool solid;
+            switch (axis) {
+                case 0:  solid = !neighbor.is_empty(layer, v, u); break;
+                case 1:  solid = !neighbor.is_empty(u, layer, v); break;
+                default: solid = !neighbor.is_empty(u, v, layer); break;
+            }
+            if (solid) {
+                const size_t bit = static_cast<size_t>(v) * layout.plane_width + u;
+                plane[bit >> 6] |= 1ull << (bit & 63);
+            }
+        }
+    }
+}
+
+uint64 mesh_borders::content_hash() const {
+    // FNV-1a по словам слоев; отсутствующий слой отличается от пустого
+    uint64 hash = 0xcbf29ce484222325ull;
+    auto combine = [&hash](uint64 value) {
+        hash ^= value;
+        hash *= 0x100000001b3ull;
+    };
+    for (int face = 0; face < 6; face++) {
+        combine(planes_[face].empty() ? ~0ull : planes_[face].size());
+        for (uint64 word : planes_[face]) {
+            combine(word);
+        }
+    }
+    return hash;
+}
+
+} // namespace voxel
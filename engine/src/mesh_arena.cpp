@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <iterator>
+
+#include <voxel/mesh_arena.h>
+#include <voxel/mesh.h>
+#include <voxel/vulkan_context.h>
+
+namespace voxel {
+
+mesh_arena::mesh_arena(std::shared_ptr<vulkan_context> context, uint32 vertex_capacity, uint32 index_capacity)
+    : context_(std::move(context)) {
+    vertex_buffer_ = std::make_unique<vertex_buffer>(
+        context_,
+        static_cast<VkDeviceSize>(vertex_capacity) * sizeof(vertex),
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+    index_buffer_ = std::make_unique<index_buffer>(
+        context_,
+        static_cast<VkDeviceSize>(index_capacity) * sizeof(uint32),
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    );
+    vertices_.reset(vertex_capacity);
+    indices_.reset(index_capacity);
+}
+
+bool mesh_arena::allocate(uint32 vertex_count, uint32 index_count, mesh_arena_range& range) {
+    if (vertex_count == 0 || index_count == 0) return false;
+
+    uint32 first_vertex;
+    if (!vertices_.allocate(vertex_count, first_vertex)) return false;
+
+    uint32 first_index;
+    if (!indices_.allocate(index_count, first_index)) {
+        vertices_.release(first_vertex, vertex_count);
+        return false;
+    }
+
+    range.first_vertex = first_vertex;
+    range.vertex_count = vertex_count;
+    range.first_index = first_index;
+    range.index_count = index_count;
+    return true;
+}
+
+void mesh_arena::release(const mesh_arena_range& range) {
+    if (!range) return;
+    retired_.push_back({range, frame_});
+}
+
+void mesh_arena::advance_frame(uint64 frame, uint64 completed_frame) {
+    frame_ = frame;
+
+    // Кадры, которые могли читать участок, завершены
+    auto expired = std::partition(retired_.begin(), retired_.end(), [completed_frame](const retired_range& retired) {
+        return retired.frame > completed_frame;
+    });
+    for (auto it = expired; it != retired_.end(); ++it) {
+        vertices_.release(it->range.first_vertex, it->range.vertex_count);
+        indices_.release(it->range.first_index, it->range.index_count);
+    }
+    retired_.erase(expired, retired_.end());
+}
+
+void mesh_arena::bind(VkCommandBuffer command_buffer) const {
+    VkBuffer vertex_buffers[] = {vertex_buffer_->get_buffer()};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+    vkCmdBindIndexBuffer(command_buffer, index_buffer_->get_buffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+// ================== range_list ==================
+
+void mesh_arena::range_list::reset(uint32 new_capacity) {
+    capacity = new_capacity;
+    used = 0;
+    free_ranges.clear();
+    if (capacity > 0) {
+        free_ranges[0] = capacity;
+    }
+}
+
+bool mesh_arena::range_list::allocate(uint32 count, uint32& offset) {
+    for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+        if (it->second < count) continue;
+
+        offset = it->first;
+        const uint32 rest = it->second - count;
+        free_ranges.erase(it);
+        if (rest > 0) {
+            free_ranges[offset + count] = rest;
+        }
+        used += count;
+        return true;
+    }
+    return false;
+}
+
+void mesh_arena::range_list::release(uint32 offset, uint32 count) {
+    used -= count;
+
+    // Сливаем с соседними свободными промежутками
+    auto next = free_ranges.lower_bound(offset);
+    if (next != free_ranges.end() && next->first == offset + count) {
+        count += next->second;
+        next = free_ranges.erase(next);
+    }
+    if (next != free_ranges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += count;
+            return;
+        }
+    }
+    free_ranges[offset] = count;
+}
+
+} // namespace voxel
@@ -0,0 +1,75 @@
+#include <voxel/mesh_cache.h>
+
+namespace voxel {
+
+mesh_cache::mesh_cache(size_t memory_limit, size_t entry_limit)
+    : memory_limit_(memory_limit), entry_limit_(entry_limit) {
+}
+
+mesh_cache_key mesh_cache::make_key(const model& model, const mesh_borders* borders, mesh_format format) {
+    mesh_cache_key key;
+    key.content = model.content_hash();
+    key.borders = borders ? borders->content_hash() : 0;
+    key.width = model.width();
+    key.height = model.height();
+    key.depth = model.depth();
+    key.format = format;
+    return key;
+}
+
+std::shared_ptr<mesh> mesh_cache::find(const mesh_cache_key& key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        misses_++;
+        return nullptr;
+    }
+    
+    hits_++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->pmesh;
+}
+
+void mesh_cache::insert(const mesh_cache_key& key, std::shared_ptr<mesh> pmesh, size_t byte_size) {
+    if (!is_enabled() || !pmesh) return;
+    
+    // Пустой меш тоже стоит памяти - иначе пустые чанки не вытеснялись бы
+    const size_t cost = byte_size + sizeof(mesh);
+    
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        memory_usage_ -= it->second->cost;
+        it->second->pmesh = std::move(pmesh);
+        it->second->cost = cost;
+        lru_.splice(lru_.begin(), lru_, it->second);
+    } else {
+        lru_.push_front({key, std::move(pmesh), cost});
+        entries_.emplace(key, lru_.begin());
+    }
+    memory_usage_ += cost;
+    
+    evict();
+}
+
+void mesh_cache::clear() {
+    lru_.clear();
+    entries_.clear();
+    memory_usage_ = 0;
+}
+
+void mesh_cache::set_limits(size_t memory_limit, size_t entry_limit) {
+    memory_limit_ = memory_limit;
+    entry_limit_ = entry_limit;
+    evict();
+}
+
+void mesh_cache::evict() {
+    while (!lru_.empty() &&
+           (memory_usage_ > memory_limit_ || (entry_limit_ > 0 && entries_.size() > entry_limit_))) {
+        const entry& oldest = lru_.back();
+        memory_usage_ -= oldest.cost;
+        entries_.erase(oldest.key);
+        lru_.pop_back();
+    }
+}
+
+} // namespace voxel
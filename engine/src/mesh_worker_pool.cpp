@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <iostream>
+
+#include <voxel/mesh_worker_pool.h>
+
+namespace voxel {
+
+mesh_worker_pool::mesh_worker_pool(size_t thread_count) {
+    start(thread_count);
+}
+
+mesh_worker_pool::~mesh_worker_pool() {
+    // Невыполненные задачи уничтожаются, их future получают broken_promise
+    stop();
+}
+
+size_t mesh_worker_pool::default_thread_count() {
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void mesh_worker_pool::submit(task_ptr task) {
+    if (!task) return;
+
+    // Задачи из основного потока раскладываются по очередям по кругу
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        worker_queue& queue = *queues_[next_queue_];
+        next_queue_ = (next_queue_ + 1) % queues_.size();
+
+        task->sequence = next_sequence_++;
+
+        std::lock_guard<std::mutex> queue_lock(queue.mutex);
+        queue.push(std::move(task));
+        pending_++;
+    }
+    wake_cv_.notify_one();
+}
+
+void mesh_worker_pool::reprioritize(
+    const std::function<float(const mesh_generation_task&)>& priority_fn
+) {
+    for (auto& queue : queues_) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        size_t removed = std::erase_if(queue->tasks, [](const task_ptr& task) {
+            return task->is_cancelled();
+        });
+        pending_ -= removed;
+        for (auto& task : queue->tasks) {
+            task->priority = priority_fn(*task);
+        }
+        std::make_heap(queue->tasks.begin(), queue->tasks.end(), task_less);
+    }
+}
+
+void mesh_worker_pool::set_thread_count(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = default_thread_count();
+    }
+    if (thread_count == threads_.size()) return;
+
+    std::vector<task_ptr> remaining = stop();
+    start(thread_count);
+    for (auto& task : remaining) {
+        submit(std::move(task));
+    }
+}
+
+std::vector<size_t> mesh_worker_pool::get_queue_depths() const {
+    std::vector<size_t> depths;
+    depths.reserve(queues_.size());
+    for (const auto& queue : queues_) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        depths.push_back(queue->tasks.size());
+    }
+    return depths;
+}
+
+void mesh_worker_pool::start(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = default_thread_count();
+    }
+
+    queues_.clear();
+    for (size_t i = 0; i < thread_count; i++) {
+        queues_.push_back(std::make_unique<worker_queue>());
+    }
+    next_queue_ = 0;
+    running_ = true;
+
+    threads_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+        threads_.emplace_back(&mesh_worker_pool::worker_function, this, i);
+    }
+}
+
+std::vector<mesh_worker_pool::task_ptr> mesh_worker_pool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        running_ = false;
+    }
+    wake_cv_.notify_all();
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+
+    // Забираем задачи, до которых потоки не успели дойти
+    std::vector<task_ptr> remaining;
+    for (auto& queue : queues_) {
+        for (auto& task : queue->tasks) {
+            remaining.push_back(std::move(task));
+        }
+        queue->tasks.clear();
+    }
+    pending_ = 0;
+    return remaining;
+}
+
+void mesh_worker_pool::worker_function(size_t index) {
+    // Номер последней поступившей задачи (next_sequence_) при неудачном поиске:
+    // поток спит, пока не придут новые задачи, а не крутится на pending_ > 0
+    bool starved = false;
+    uint64 seen_sequence = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_cv_.wait(lock, [this, starved, seen_sequence] {
+                return !running_ || (pending_.load() > 0 && (!starved || next_sequence_ != seen_sequence));
+            });
+
+            if (!running_) {
+                break;
+            }
+            seen_sequence = next_sequence_;
+        }
+
+        // Пусто - задачи, поступившие до seen_sequence, забрали другие потоки
+        task_ptr task = pop_task(index);
+        starved = !task;
+        if (!task) continue;
+
+        run_task(*task);
+    }
+}
+
+mesh_worker_pool::task_ptr mesh_worker_pool::pop_task(size_t index) {
+    worker_queue& local = *queues_[index];
+
+    // Одновременно блокируется не больше одной очереди; вершины чужих очередей
+    // сравниваются со снимком своей, и кража идет, только если чужая приоритетнее
+    while (true) {
+        task_key local_top{};
+        bool has_local;
+        {
+            std::lock_guard<std::mutex> lock(local.mutex);
+            has_local = local.peek(local_top);
+        }
+
+        worker_queue* victim = nullptr;
+        task_key victim_top{};
+        for (size_t offset = 1; offset < queues_.size(); offset++) {
+            worker_queue& queue = *queues_[(index + offset) % queues_.size()];
+            task_key top{};
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.peek(top)) continue;
+            }
+            if ((!has_local || key_less(local_top, top)) && (!victim || key_less(victim_top, top))) {
+                victim = &queue;
+                victim_top = top;
+            }
+        }
+
+        if (victim) {
+            std::lock_guard<std::mutex> lock(victim->mutex);
+            task_key top{};
+            if (victim->peek(top) && (!has_local || key_less(local_top, top))) {
+                pending_--;
+                return victim->pop();
+            }
+            // Вершину забрал другой поток - просматриваем очереди заново
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(local.mutex);
+        if (!local.tasks.empty()) {
+            pending_--;
+            return local.pop();
+        }
+        if (!has_local) return nullptr;
+        // Свою вершину украли, пока просматривались чужие очереди
+    }
+}
+
+bool mesh_worker_pool::key_less(const task_key& a, const task_key& b) {
+    // Вершина кучи - наибольший приоритет, при равенстве - самая ранняя задача
+    if (a.priority != b.priority) {
+        return a.priority < b.priority;
+    }
+    return a.sequence > b.sequence;
+}
+
+bool mesh_worker_pool::task_less(const task_ptr& a, const task_ptr& b) {
+    return key_less({a->priority, a->sequence}, {b->priority, b->sequence});
+}
+
+void mesh_worker_pool::worker_queue::push(task_ptr task) {
+    tasks.push_back(std::move(task));
+    std::push_heap(tasks.begin(), tasks.end(), task_less);
+}
+
+bool mesh_worker_pool::worker_queue::peek(task_key& key) const {
+    if (tasks.empty()) return false;
+    key = {tasks.front()->priority, tasks.front()->sequence};
+    return true;
+}
+
+mesh_worker_pool::task_ptr mesh_worker_pool::worker_queue::pop() {
+    std::pop_heap(tasks.begin(), tasks.end(), task_less);
+    task_ptr task = std::move(tasks.back());
+    tasks.pop_back();
+    return task;
+}
+
+void mesh_worker_pool::run_task(mesh_generation_task& task) {
+    // Результат отмененной задачи никто не ждет - promise просто уничтожается
+    if (task.is_cancelled()) return;
+
+    try {
+        // Генерируем данные меша в рабочем потоке (без Vulkan буферов)
+        mesh_data data = binary_mesh_generator::generate_mesh_data(
+            task.pmodel, task.borders.get(), task.format, task.cancelled.get()
+        );
+        if (task.is_cancelled()) return;
+
+        // Возвращаем результат
+        task.promise.set_value(std::move(data));
+    } catch (const std::exception& e) {
+        // В случае ошибки возвращаем пустые данные
+        std::cerr << "Ошибка генерации меша " << task.id << ": " << e.what() << std::endl;
+        task.promise.set_value(mesh_data());
+    }
+}
+
+} // namespace voxel
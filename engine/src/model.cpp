@@ -1,46 +1,183 @@
 #include <stdexcept>
+#include <algorithm>
 
 #include <voxel/types.h>
 #include <voxel/model.h>
 
 namespace voxel {
-    model::model(int width, int height, int depth)
-        : width_(width), height_(height), depth_(depth), 
-          voxels_(width * height * depth, voxel()) {}
+    namespace {
+        constexpr uint64 HASH_SEED_LO = 0x9e3779b97f4a7c15ull;
+        constexpr uint64 HASH_SEED_HI = 0xc2b2ae3d27d4eb4full;
+
+        inline uint64 mix64(uint64 x) {
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ull;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebull;
+            x ^= x >> 31;
+            return x;
+        }
+
+        // Вклад ячейки - вес позиции, умноженный на вес цвета; хэш модели - сумма
+        // вкладов, поэтому запись одной ячейки пересчитывает его за O(1).
+        // Пустые ячейки вклада не дают
+        inline uint64 position_weight(uint64 index, uint64 seed) { return mix64(index ^ seed); }
+        inline uint64 color_weight(uint32 color, uint64 seed) { return mix64(color + seed) | 1; }
+    }
+
+    model::model(int width, int height, int depth, model_storage storage)
+        : width_(width), height_(height), depth_(depth), storage_(storage) {
+        // Пустая модель сразу создается в своем хранении, без плотного массива
+        const size_t count = static_cast<size_t>(width_) * height_ * depth_;
+        switch (storage) {
+            case model_storage::palette:
+                palette_ = palette_storage(count);
+                break;
+            case model_storage::sparse:
+                bricks_ = brick_storage(width_, height_, depth_);
+                break;
+            default:
+                voxels_.assign(count, voxel());
+                break;
+        }
+    }
 
     void model::set_voxel(int x, int y, int z, const voxel& voxel) {
         if (x < 0 || x >= width_ || y < 0 || y >= height_ || z < 0 || z >= depth_)
             throw std::out_of_range("model::set_voxel: coordinates out of range");
+        
+        update_hash(index(x, y, z), get_voxel_unchecked(x, y, z).color, voxel.color);
+        
+        if (storage_ == model_storage::palette) {
+            if (palette_.set(index(x, y, z), voxel)) return;
+            
+            // Палитра переполнена - переходим на плотное хранение
+            set_storage(model_storage::dense);
+        } else if (storage_ == model_storage::sparse) {
+            bricks_.set(x, y, z, voxel);
+            return;
+        }
         voxels_[index(x, y, z)] = voxel;
     }
 
     voxel model::get_voxel(int x, int y, int z) const {
         if (x < 0 || x >= width_ || y < 0 || y >= height_ || z < 0 || z >= depth_)
             throw std::out_of_range("model::get_voxel: coordinates out of range");
-        return voxels_[index(x, y, z)];
+        return get_voxel_unchecked(x, y, z);
     }
 
     bool model::has_voxel(int x, int y, int z) const {
         if (x < 0 || x >= width_ || y < 0 || y >= height_ || z < 0 || z >= depth_)
             return false;
-        return voxels_[index(x, y, z)].color != 0;
+        return get_voxel_unchecked(x, y, z).color != 0;
     }
 
     bool model::is_empty(int x, int y, int z) const {
         if (x < 0 || x >= width_ || y < 0 || y >= height_ || z < 0 || z >= depth_)
             return true;
-        return voxels_[index(x, y, z)].color == 0;
+        return get_voxel_unchecked(x, y, z).color == 0;
     }
 
     void model::clear() {
-        std::fill(voxels_.begin(), voxels_.end(), voxel());
+        fill(voxel());
     }
 
     void model::fill(const voxel& voxel) {
-        std::fill(voxels_.begin(), voxels_.end(), voxel);
+        // Все ячейки одного цвета: хэш - сумма весов позиций, умноженная на вес цвета
+        if (voxel.color == 0) {
+            hash_ = model_hash();
+        } else {
+            if (!fill_weight_ready_) {
+                const uint64 count = static_cast<uint64>(width_) * height_ * depth_;
+                fill_weight_ = model_hash();
+                for (uint64 i = 0; i < count; i++) {
+                    fill_weight_.lo += position_weight(i, HASH_SEED_LO);
+                    fill_weight_.hi += position_weight(i, HASH_SEED_HI);
+                }
+                fill_weight_ready_ = true;
+            }
+            hash_.lo = fill_weight_.lo * color_weight(voxel.color, HASH_SEED_LO);
+            hash_.hi = fill_weight_.hi * color_weight(voxel.color, HASH_SEED_HI);
+        }
+        
+        if (storage_ == model_storage::palette) {
+            palette_.fill(voxel);
+        } else if (storage_ == model_storage::sparse) {
+            bricks_.fill(voxel);
+        } else {
+            std::fill(voxels_.begin(), voxels_.end(), voxel);
+        }
+    }
+
+    void model::set_storage(model_storage storage) {
+        if (storage == storage_) return;
+        
+        const size_t count = static_cast<size_t>(width_) * height_ * depth_;
+        std::vector<voxel> dense;
+        palette_storage packed;
+        brick_storage bricks;
+        switch (storage) {
+            case model_storage::dense:
+                dense.resize(count);
+                for (int z = 0; z < depth_; z++)
+                    for (int y = 0; y < height_; y++)
+                        for (int x = 0; x < width_; x++)
+                            dense[index(x, y, z)] = get_voxel_unchecked(x, y, z);
+                break;
+            case model_storage::palette:
+                packed = palette_storage(count);
+                for (int z = 0; z < depth_; z++)
+                    for (int y = 0; y < height_; y++)
+                        for (int x = 0; x < width_; x++) {
+                            // Больше 65536 цветов - остаемся на текущем хранении
+                            if (!packed.set(index(x, y, z), get_voxel_unchecked(x, y, z))) return;
+                        }
+                break;
+            case model_storage::sparse:
+                bricks = brick_storage(width_, height_, depth_);
+                for (int z = 0; z < depth_; z++)
+                    for (int y = 0; y < height_; y++)
+                        for (int x = 0; x < width_; x++) {
+                            const voxel v = get_voxel_unchecked(x, y, z);
+                            if (v.color != 0) bricks.set(x, y, z, v);
+                        }
+                bricks.optimize();
+                break;
+        }
+        voxels_ = std::move(dense);
+        palette_ = std::move(packed);
+        bricks_ = std::move(bricks);
+        storage_ = storage;
+    }
+
+    void model::optimize_storage() {
+        if (storage_ == model_storage::sparse) {
+            bricks_.optimize();
+        }
+    }
+
+    void model::update_hash(int index, uint32 old_color, uint32 new_color) {
+        if (old_color == new_color) return;
+        
+        const uint64 lo = position_weight(static_cast<uint64>(index), HASH_SEED_LO);
+        const uint64 hi = position_weight(static_cast<uint64>(index), HASH_SEED_HI);
+        if (old_color != 0) {
+            hash_.lo -= lo * color_weight(old_color, HASH_SEED_LO);
+            hash_.hi -= hi * color_weight(old_color, HASH_SEED_HI);
+        }
+        if (new_color != 0) {
+            hash_.lo += lo * color_weight(new_color, HASH_SEED_LO);
+            hash_.hi += hi * color_weight(new_color, HASH_SEED_HI);
+        }
     }
 
-    int model::index(int x, int y, int z) const {
-        return x + y * width_ + z * width_ * height_;
+    size_t model::memory_usage() const {
+        if (storage_ == model_storage::palette) {
+            return palette_.memory_usage();
+        }
+        if (storage_ == model_storage::sparse) {
+            return bricks_.memory_usage();
+        }
+        return voxels_.capacity() * sizeof(voxel);
     }
-} 
\ No newline at end of file
+}
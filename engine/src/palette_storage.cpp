@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include <voxel/palette_storage.h>
+
+namespace voxel {
+
+palette_storage::palette_storage(size_t size, const voxel& value) : size_(size) {
+    fill(value);
+}
+
+bool palette_storage::set(size_t index, const voxel& value) {
+    uint32 palette_index;
+    auto it = palette_lookup_.find(value.color);
+    if (it != palette_lookup_.end()) {
+        palette_index = it->second;
+    } else {
+        if (palette_.size() >= (size_t(1) << MAX_BITS)) {
+            return false;
+        }
+        palette_index = static_cast<uint32>(palette_.size());
+        palette_.push_back(value);
+        palette_lookup_[value.color] = palette_index;
+
+        // Палитра переросла текущую ширину индекса - расширяем
+        if (palette_.size() > (size_t(1) << bits_per_voxel())) {
+            repack(bits_shift_ + 1);
+        }
+    }
+
+    write_index(index, palette_index);
+    return true;
+}
+
+void palette_storage::fill(const voxel& value) {
+    palette_.clear();
+    palette_lookup_.clear();
+
+    palette_.push_back(voxel());
+    palette_lookup_[0] = 0;
+
+    uint32 fill_index = 0;
+    if (!value.is_empty()) {
+        palette_.push_back(value);
+        palette_lookup_[value.color] = 1;
+        fill_index = 1;
+    }
+
+    set_bits(0);
+    // При 1 бите на воксел заполнение единицами - все биты слова
+    data_.assign((size_ + entries_mask_) >> entries_shift_, fill_index ? ~0ull : 0ull);
+}
+
+size_t palette_storage::memory_usage() const {
+    return data_.capacity() * sizeof(uint64) +
+           palette_.capacity() * sizeof(voxel) +
+           palette_lookup_.size() * (sizeof(uint32) * 2 + sizeof(void*) * 2);
+}
+
+void palette_storage::set_bits(uint32 bits_shift) {
+    bits_shift_ = bits_shift;
+    entries_shift_ = 6 - bits_shift;
+    entries_mask_ = (1ull << entries_shift_) - 1;
+    value_mask_ = (1ull << (1u << bits_shift)) - 1;
+}
+
+void palette_storage::repack(uint32 bits_shift) {
+    palette_storage packed;
+    packed.size_ = size_;
+    packed.set_bits(bits_shift);
+    packed.data_.assign((size_ + packed.entries_mask_) >> packed.entries_shift_, 0);
+
+    for (size_t i = 0; i < size_; i++) {
+        packed.write_index(i, read_index(i));
+    }
+
+    data_ = std::move(packed.data_);
+    set_bits(bits_shift);
+}
+
+uint32 palette_storage::read_index(size_t index) const {
+    const uint64 word = data_[index >> entries_shift_];
+    const uint32 shift = static_cast<uint32>(index & entries_mask_) << bits_shift_;
+    return static_cast<uint32>((word >> shift) & value_mask_);
+}
+
+void palette_storage::write_index(size_t index, uint32 value) {
+    uint64& word = data_[index >> entries_shift_];
+    const uint32 shift = static_cast<uint32>(index & entries_mask_) << bits_shift_;
+    word = (word & ~(value_mask_ << shift)) | (static_cast<uint64>(value) << shift);
+}
+
+} // namespace voxel
@@ -0,0 +1,180 @@
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#include <voxel/pipeline_cache.h>
+
+namespace voxel {
+
+pipeline_cache::pipeline_cache(VkDevice device, VkPhysicalDevice physical_device, std::filesystem::path path)
+    : device_(device), path_(std::move(path)) {
+    vkGetPhysicalDeviceProperties(physical_device, &properties_);
+
+    const std::vector<uint8> data = load_data();
+
+    VkPipelineCacheCreateInfo cache_info{};
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.initialDataSize = data.size();
+    cache_info.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(device_, &cache_info, nullptr, &cache_) != VK_SUCCESS) {
+        // Драйвер отверг данные - пробуем пустой кэш
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = nullptr;
+        if (data.empty() || vkCreatePipelineCache(device_, &cache_info, nullptr, &cache_) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+        return;
+    }
+    loaded_ = !data.empty();
+}
+
+pipeline_cache::~pipeline_cache() {
+    save();
+    vkDestroyPipelineCache(device_, cache_, nullptr);
+}
+
+bool pipeline_cache::save() const {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS || size == 0) {
+        return false;
+    }
+    std::vector<uint8> data(size);
+    if (vkGetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS) {
+        return false;
+    }
+    data.resize(size);
+
+    const file_header header{MAGIC, VERSION, static_cast<uint64>(data.size()), checksum(data.data(), data.size())};
+
+    // Недописанный файл не заменяет прежний
+    std::error_code error;
+    if (path_.has_parent_path()) {
+        std::filesystem::create_directories(path_.parent_path(), error);
+    }
+    std::filesystem::path temp_path = path_;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            std::cerr << "pipeline_cache: failed to write " << temp_path.string() << std::endl;
+            return false;
+        }
+    }
+    std::filesystem::rename(temp_path, path_, error);
+    if (error) {
+        std::cerr << "pipeline_cache: failed to replace " << path_.string() << ": " << error.message() << std::endl;
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint8> pipeline_cache::load_data() const {
+    std::ifstream file(path_, std::ios::binary);
+    if (!file) return {};
+
+    std::error_code error;
+    const uint64 file_size = std::filesystem::file_size(path_, error);
+
+    file_header header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || error || header.magic != MAGIC || header.version != VERSION ||
+        header.data_size != file_size - sizeof(header)) {
+        std::cerr << "pipeline_cache: ignoring invalid " << path_.string() << std::endl;
+        return {};
+    }
+
+    std::vector<uint8> data(static_cast<size_t>(header.data_size));
+    file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    if (!file || checksum(data.data(), data.size()) != header.checksum) {
+        std::cerr << "pipeline_cache: ignoring damaged " << path_.string() << std::endl;
+        return {};
+    }
+
+    // Кэш другого устройства или драйвера драйвер не обязан проверять сам
+    if (!is_compatible(data)) {
+        return {};
+    }
+    return data;
+}
+
+bool pipeline_cache::is_compatible(const std::vector<uint8>& data) const {
+    // Заголовок данных (VK_PIPELINE_CACHE_HEADER_VERSION_ONE): размер заголовка,
+    // версия, vendorID, deviceID, pipelineCacheUUID
+    constexpr size_t HEADER_SIZE = 16 + VK_UUID_SIZE;
+    if (data.size() < HEADER_SIZE) return false;
+
+    uint32 fields[4];
+    std::memcpy(fields, data.data(), sizeof(fields));
+    return fields[0] >= HEADER_SIZE &&
+        fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        fields[2] == properties_.vendorID &&
+        fields[3] == properties_.deviceID &&
+        std::memcmp(data.data() + 16, properties_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+std::filesystem::path pipeline_cache::default_path() {
+    // Пустые переменные окружения считаются незаданными
+    const auto environment = [](const char* name) -> std::filesystem::path {
+        const char* value = std::getenv(name);
+        return value && *value ? std::filesystem::path(value) : std::filesystem::path();
+    };
+
+    std::filesystem::path directory;
+#ifdef _WIN32
+    directory = environment("LOCALAPPDATA");
+#else
+    directory = environment("XDG_CACHE_HOME");
+    if (directory.empty()) {
+        const std::filesystem::path home = environment("HOME");
+        if (!home.empty()) {
+            directory = home / ".cache";
+        }
+    }
+#endif
+    if (!directory.empty()) {
+        return directory / DIRECTORY_NAME / FILE_NAME;
+    }
+
+    // Нет пользовательского каталога - рядом с исполняемым файлом
+    std::filesystem::path executable;
+#ifdef _WIN32
+    wchar_t buffer[MAX_PATH];
+    const DWORD length = GetModuleFileNameW(nullptr, buffer, MAX_PATH);
+    if (length > 0 && length < MAX_PATH) {
+        executable = std::filesystem::path(std::wstring(buffer, length));
+    }
+#else
+    std::error_code error;
+    executable = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (error) {
+        executable.clear();
+    }
+#endif
+    if (executable.has_parent_path()) {
+        return executable.parent_path() / FILE_NAME;
+    }
+    return FILE_NAME;
+}
+
+uint64 pipeline_cache::checksum(const uint8* data, size_t size) {
+    // FNV-1a
+    uint64 hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+} // namespace voxel
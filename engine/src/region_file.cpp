@@ -0,0 +1,214 @@
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <voxel/region_file.h>
+
+namespace voxel {
+
+region_file::region_file(const std::filesystem::path& path)
+    : path_(path) {
+    if (!std::filesystem::exists(path_)) {
+        create();
+    }
+    
+    file_.open(path_, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file_) {
+        throw std::runtime_error("region_file: failed to open " + path_.string());
+    }
+    read_table();
+    map();
+}
+
+region_file::~region_file() {
+    unmap();
+}
+
+bool region_file::read_chunk(int index, const std::function<void(const uint8* data, size_t size)>& reader) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    const table_entry& entry = table_[index];
+    if (entry.size == 0) return false;
+    
+    const size_t offset = static_cast<size_t>(entry.sector) * SECTOR_SIZE;
+    if (offset + entry.size > size_) return false;
+    
+    reader(data_ + offset, entry.size);
+    return true;
+}
+
+bool region_file::has_chunk(int index) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return table_[index].size != 0;
+}
+
+void region_file::write_chunks(const std::vector<std::pair<int, std::vector<uint8>>>& chunks) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    
+    // Запись может расширить файл - отображение пересоздается после нее
+    unmap();
+    
+    static const char zeros[SECTOR_SIZE] = {};
+    // Старые секторы освобождаются только после записи таблицы: до этого на них
+    // ссылается таблица в файле, и следующий чанк пакета не должен их занять
+    std::vector<std::pair<uint32, uint32>> freed;
+    for (const auto& [index, data] : chunks) {
+        table_entry& entry = table_[index];
+        const table_entry old = entry;
+        
+        if (data.empty()) {
+            entry = table_entry();
+        } else {
+            const uint32 count = sector_count(static_cast<uint32>(data.size()));
+            const uint32 sector = allocate_sectors(count);
+            
+            file_.seekp(static_cast<std::streamoff>(sector) * SECTOR_SIZE);
+            file_.write(reinterpret_cast<const char*>(data.data()), data.size());
+            file_.write(zeros, static_cast<std::streamsize>(count) * SECTOR_SIZE - data.size());
+            
+            entry.sector = sector;
+            entry.size = static_cast<uint32>(data.size());
+        }
+        
+        if (old.size != 0) {
+            freed.emplace_back(old.sector, sector_count(old.size));
+        }
+    }
+    
+    file_.seekp(HEADER_SIZE);
+    file_.write(reinterpret_cast<const char*>(table_.data()), sizeof(table_));
+    file_.flush();
+    if (!file_) {
+        file_.clear();
+        map();
+        throw std::runtime_error("region_file: failed to write " + path_.string());
+    }
+    
+    for (const auto& [sector, count] : freed) {
+        mark_sectors(sector, count, false);
+    }
+    
+    map();
+}
+
+void region_file::create() {
+    std::ofstream file(path_, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("region_file: failed to create " + path_.string());
+    }
+    
+    const uint32 header[4] = {MAGIC, VERSION, static_cast<uint32>(REGION_SIZE), 0};
+    std::vector<char> sectors(static_cast<size_t>(DATA_SECTOR) * SECTOR_SIZE, 0);
+    std::memcpy(sectors.data(), header, sizeof(header));
+    file.write(sectors.data(), sectors.size());
+}
+
+void region_file::read_table() {
+    uint32 header[4] = {};
+    file_.seekg(0);
+    file_.read(reinterpret_cast<char*>(header), sizeof(header));
+    file_.read(reinterpret_cast<char*>(table_.data()), sizeof(table_));
+    if (!file_ || header[0] != MAGIC || header[1] != VERSION || header[2] != static_cast<uint32>(REGION_SIZE)) {
+        throw std::runtime_error("region_file: invalid region file " + path_.string());
+    }
+    
+    file_.seekg(0, std::ios::end);
+    const uint64 file_size = static_cast<uint64>(file_.tellg());
+    used_sectors_.assign(std::max<uint64>(DATA_SECTOR, file_size / SECTOR_SIZE), false);
+    mark_sectors(0, DATA_SECTOR, true);
+    
+    for (auto& entry : table_) {
+        if (entry.size == 0) continue;
+        
+        // Запись за пределами файла - чанк считается потерянным
+        const uint32 count = sector_count(entry.size);
+        if (entry.sector < DATA_SECTOR || static_cast<uint64>(entry.sector) + count > used_sectors_.size()) {
+            entry = table_entry();
+            continue;
+        }
+        mark_sectors(entry.sector, count, true);
+    }
+}
+
+void region_file::map() {
+    const size_t size = used_sectors_.size() * static_cast<size_t>(SECTOR_SIZE);
+    
+#ifdef _WIN32
+    HANDLE file = CreateFileW(
+        path_.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("region_file: failed to map " + path_.string());
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        throw std::runtime_error("region_file: failed to map " + path_.string());
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+    CloseHandle(mapping);
+    if (!view) {
+        throw std::runtime_error("region_file: failed to map " + path_.string());
+    }
+#else
+    int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("region_file: failed to map " + path_.string());
+    }
+    void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error("region_file: failed to map " + path_.string());
+    }
+#endif
+    
+    data_ = static_cast<const uint8*>(view);
+    size_ = size;
+}
+
+void region_file::unmap() {
+    if (!data_) return;
+    
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(const_cast<uint8*>(data_), size_);
+#endif
+    
+    data_ = nullptr;
+    size_ = 0;
+}
+
+uint32 region_file::allocate_sectors(uint32 count) {
+    // Первый подходящий отрезок свободных секторов; иначе - в конец файла
+    uint32 run = 0;
+    for (uint32 sector = DATA_SECTOR; sector < used_sectors_.size(); sector++) {
+        run = used_sectors_[sector] ? 0 : run + 1;
+        if (run == count) {
+            mark_sectors(sector + 1 - count, count, true);
+            return sector + 1 - count;
+        }
+    }
+    
+    const uint32 sector = static_cast<uint32>(used_sectors_.size()) - run;
+    used_sectors_.resize(sector + count, false);
+    mark_sectors(sector, count, true);
+    return sector;
+}
+
+void region_file::mark_sectors(uint32 sector, uint32 count, bool used) {
+    std::fill(used_sectors_.begin() + sector, used_sectors_.begin() + sector + count, used);
+}
+
+} // namespace voxel
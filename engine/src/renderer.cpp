@@ -6,7 +6,10 @@
 #include "voxel/shader.h"
 #include "voxel/buffer.h"
 #include "voxel/world.h"
-#include "voxel/buffer.h"
+#include "voxel/mesh_arena.h"
+#include "voxel/gpu_culler.h"
+#include "voxel/hiz_pyramid.h"
+#include "voxel/command_recorder.h"
 #include "voxel/math_utils.h"
 
 #include <algorithm>
@@ -19,8 +22,12 @@
 namespace voxel {
 
 renderer::renderer(std::shared_ptr<vulkan_context> context, std::shared_ptr<window> window)
-    : context_(std::move(context)), window_(std::move(window)), swapchain_(VK_NULL_HANDLE), render_pass_(VK_NULL_HANDLE),
+    : context_(std::move(context)), window_(std::move(window)), swapchain_(VK_NULL_HANDLE),
+      depth_format_(VK_FORMAT_UNDEFINED), depth_image_(VK_NULL_HANDLE), depth_image_view_(VK_NULL_HANDLE), render_pass_(VK_NULL_HANDLE),
       descriptor_set_layout_(VK_NULL_HANDLE), pipeline_layout_(VK_NULL_HANDLE), graphics_pipeline_(VK_NULL_HANDLE),
+      quad_pipeline_layout_(VK_NULL_HANDLE), quad_pipeline_(VK_NULL_HANDLE),
+      instanced_pipeline_layout_(VK_NULL_HANDLE), instanced_pipeline_(VK_NULL_HANDLE),
+      draw_indirect_(false), max_draw_indirect_count_(1),
       descriptor_pool_(VK_NULL_HANDLE), current_frame_(0),
       current_image_index_(0), framebuffer_resized_(false) {
     
@@ -29,9 +36,24 @@ renderer::renderer(std::shared_ptr<vulkan_context> context, std::shared_ptr<wind
     // Создаем шейдеры
     vertex_shader_ = std::make_unique<shader>(context_, "shaders/voxel_vert.spv", shader_type::VERTEX);
     fragment_shader_ = std::make_unique<shader>(context_, "shaders/voxel_frag.spv", shader_type::FRAGMENT);
+    quad_vertex_shader_ = std::make_unique<shader>(context_, "shaders/voxel_quad_vert.spv", shader_type::VERTEX);
+    instanced_vertex_shader_ = std::make_unique<shader>(context_, "shaders/voxel_instanced_vert.spv", shader_type::VERTEX);
+
+    // firstInstance в косвенных командах требует drawIndirectFirstInstance
+    draw_indirect_ = context_->get_enabled_features().drawIndirectFirstInstance;
+
+    // Без multiDrawIndirect каждая команда - отдельный vkCmdDrawIndexedIndirect
+    if (context_->get_enabled_features().multiDrawIndirect) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(context_->get_physical_device(), &properties);
+        max_draw_indirect_count_ = std::max<uint32>(properties.limits.maxDrawIndirectCount, 1);
+    }
+
+    depth_format_ = find_depth_format();
 
     create_swapchain();
     create_image_views();
+    create_depth_resources();
     create_render_pass();
     create_descriptor_set_layout();
     create_graphics_pipeline();
@@ -41,6 +63,19 @@ renderer::renderer(std::shared_ptr<vulkan_context> context, std::shared_ptr<wind
     create_uniform_buffers();
     create_descriptor_pool();
     create_descriptor_sets();
+
+    // Отсечение на GPU зависит только от возможностей устройства; шейдер
+    // собирается вместе с движком, и его отсутствие - ошибка, а не выключенный режим
+    if (draw_indirect_ && context_->get_cmd_draw_indexed_indirect_count()) {
+        hiz_ = std::make_unique<hiz_pyramid>(context_);
+        hiz_->resize(depth_image_view_, swapchain_extent_);
+        gpu_culler_ = std::make_unique<gpu_culler>(context_, MAX_FRAMES_IN_FLIGHT, max_draw_indirect_count_, *hiz_);
+    }
+
+    // Запись объектов вторичными буферами - только если есть больше одного ядра
+    if (command_recorder::default_thread_count() > 1) {
+        recorder_ = std::make_unique<command_recorder>(context_, MAX_FRAMES_IN_FLIGHT);
+    }
 }
 
 renderer::~renderer() {
@@ -59,6 +94,31 @@ renderer::~renderer() {
         pipeline_layout_ = VK_NULL_HANDLE;
     }
     
+    // Освобождаем pipeline квадов
+    if (quad_pipeline_ != VK_NULL_HANDLE) {
+        vkDestroyPipeline(context_->get_device(), quad_pipeline_, nullptr);
+        quad_pipeline_ = VK_NULL_HANDLE;
+    }
+    if (quad_pipeline_layout_ != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(context_->get_device(), quad_pipeline_layout_, nullptr);
+        quad_pipeline_layout_ = VK_NULL_HANDLE;
+    }
+    
+    // Освобождаем pipeline экземпляров и его буферы
+    if (instanced_pipeline_ != VK_NULL_HANDLE) {
+        vkDestroyPipeline(context_->get_device(), instanced_pipeline_, nullptr);
+        instanced_pipeline_ = VK_NULL_HANDLE;
+    }
+    if (instanced_pipeline_layout_ != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(context_->get_device(), instanced_pipeline_layout_, nullptr);
+        instanced_pipeline_layout_ = VK_NULL_HANDLE;
+    }
+    transform_buffers_.clear();
+    indirect_buffers_.clear();
+    gpu_culler_.reset();
+    hiz_.reset();
+    recorder_.reset();
+    
     // Освобождаем descriptor set layout
     if (descriptor_set_layout_ != VK_NULL_HANDLE) {
         vkDestroyDescriptorSetLayout(context_->get_device(), descriptor_set_layout_, nullptr);
@@ -79,15 +139,17 @@ renderer::~renderer() {
     
     // Освобождаем шейдеры
     vertex_shader_.reset();
+    quad_vertex_shader_.reset();
+    instanced_vertex_shader_.reset();
     fragment_shader_.reset();
 }
 
 void renderer::begin_frame() {
+    frame_started_ = false;
+    
     // Ждем завершения предыдущего кадра
     vkWaitForFences(context_->get_device(), 1, &in_flight_fences_[current_frame_], VK_TRUE, UINT64_MAX);
-
-    // Сбрасываем fence для рендеринга перед использованием
-    vkResetFences(context_->get_device(), 1, &in_flight_fences_[current_frame_]);
+    completed_frame_ = std::max(completed_frame_, frame_serials_[current_frame_]);
 
     // Получаем следующий image из swapchain (используем семафор)
     uint32_t image_index;
@@ -100,6 +162,7 @@ void renderer::begin_frame() {
         &image_index
     );
 
+    // Кадр пропускается: fence остается сигнальным, семафор не ждет ничего
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         recreate_swapchain();
         return;
@@ -107,7 +170,11 @@ void renderer::begin_frame() {
         throw std::runtime_error("Failed to acquire swap chain image!");
     }
 
+    // Сбрасываем fence только для кадра, который будет отправлен
+    vkResetFences(context_->get_device(), 1, &in_flight_fences_[current_frame_]);
+
     current_image_index_ = image_index;
+    frame_started_ = true;
 
     // Ждем завершения предыдущего использования этого изображения
     if (images_in_flight_[image_index] != VK_NULL_HANDLE) {
@@ -119,6 +186,9 @@ void renderer::begin_frame() {
 }
 
 void renderer::end_frame() {
+    if (!frame_started_) return;
+    frame_started_ = false;
+    
     VkSubmitInfo submit_info{};
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -138,6 +208,7 @@ void renderer::end_frame() {
     if (vkQueueSubmit(context_->get_graphics_queue(), 1, &submit_info, in_flight_fences_[current_frame_]) != VK_SUCCESS) {
         throw std::runtime_error("Failed to submit draw command buffer!");
     }
+    frame_serials_[current_frame_] = ++submitted_frame_;
 
     VkPresentInfoKHR present_info{};
     present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -162,7 +233,7 @@ void renderer::end_frame() {
 }
 
 void renderer::render_mesh(std::shared_ptr<mesh> mesh, const vec3f& position, const vec3f& rotation, const vec3f& scale) {
-    if (!mesh) return;
+    if (!mesh || !frame_started_) return;
     
     // Биндим меш
     mesh->bind(command_buffers_[current_image_index_]);
@@ -172,7 +243,10 @@ void renderer::render_mesh(std::shared_ptr<mesh> mesh, const vec3f& position, co
 }
 
 void renderer::render_world(const std::shared_ptr<world>& world, const std::shared_ptr<camera>& camera) {
-    if (!camera || !world) return;
+    if (!camera || !world || !frame_started_) return;
+    
+    // Кадр читает текущие меши мира: отложенные после этого меши ждут его завершения
+    world->set_frame_progress(submitted_frame_ + 1, completed_frame_);
     
     // Обновляем uniform buffer для текущего кадра
     update_uniform_buffer(camera);
@@ -186,6 +260,9 @@ void renderer::render_world(const std::shared_ptr<world>& world, const std::shar
         throw std::runtime_error("Failed to begin recording command buffer!");
     }
 
+    // Объекты вне пирамиды видимости не рисуются; отсечение на GPU - до render pass
+    cull_objects(command_buffers_[current_image_index_], *world, *camera);
+
     // Начинаем рендер пасс
     VkRenderPassBeginInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -194,61 +271,377 @@ void renderer::render_world(const std::shared_ptr<world>& world, const std::shar
     render_pass_info.renderArea.offset = {0, 0};
     render_pass_info.renderArea.extent = swapchain_extent_;
 
-    VkClearValue clear_color = {{{clear_color_.r, clear_color_.g, clear_color_.b, clear_color_.a}}};
-    render_pass_info.clearValueCount = 1;
-    render_pass_info.pClearValues = &clear_color;
+    std::array<VkClearValue, 2> clear_values{};
+    clear_values[0].color = {{clear_color_.r, clear_color_.g, clear_color_.b, clear_color_.a}};
+    clear_values[1].depthStencil = {1.0f, 0};
+    render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+    render_pass_info.pClearValues = clear_values.data();
 
-    vkCmdBeginRenderPass(command_buffers_[current_image_index_], &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    // Индексированные меши - экземплярами: объекты с общим мешем рисуются одним вызовом
+    prepare_instanced(*world);
 
-    // Биндим pipeline
-    vkCmdBindPipeline(command_buffers_[current_image_index_], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline_);
+    // Остальные объекты - по одному, от ближних к дальним
+    const auto& objects = world->get_renderable_objects();
+    object_draws_.clear();
+    for (uint32 index : draw_order_) {
+        const mesh_format format = objects[index]->pmesh->get_format();
+        if (format == mesh_format::indexed) continue;
+        object_draws_.push_back(index);
+    }
 
-    // Биндим descriptor set
+    VkCommandBuffer command_buffer = command_buffers_[current_image_index_];
+    const bool parallel = recorder_ && group_draws_.size() + object_draws_.size() >= PARALLEL_RECORDING_MIN_DRAWS;
+    if (!parallel) {
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        set_viewport(command_buffer);
+        draw_indirect(command_buffer, *world);
+        draw_gpu_culled(command_buffer, *world);
+        draw_instance_groups(command_buffer, 0, group_draws_.size());
+        draw_objects(command_buffer, *world, 0, object_draws_.size());
+    } else {
+        // Участок 0 - косвенный вызов арены и меши, отсеченные на GPU, дальше - группы
+        // экземпляров и объекты по RECORDING_RANGE_SIZE; буферы выполняются в порядке участков
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = render_pass_;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = framebuffers_[current_image_index_];
+
+        const size_t group_ranges = (group_draws_.size() + RECORDING_RANGE_SIZE - 1) / RECORDING_RANGE_SIZE;
+        const size_t object_ranges = (object_draws_.size() + RECORDING_RANGE_SIZE - 1) / RECORDING_RANGE_SIZE;
+        const auto& secondary_buffers = recorder_->record(
+            current_frame_, inheritance, 1 + group_ranges + object_ranges,
+            [this, &world, group_ranges](VkCommandBuffer secondary, size_t range) {
+                // Динамическое состояние не наследуется вторичными буферами
+                set_viewport(secondary);
+                if (range == 0) {
+                    draw_indirect(secondary, *world);
+                    draw_gpu_culled(secondary, *world);
+                    return;
+                }
+                if (range <= group_ranges) {
+                    const size_t begin = (range - 1) * RECORDING_RANGE_SIZE;
+                    draw_instance_groups(secondary, begin, std::min(begin + RECORDING_RANGE_SIZE, group_draws_.size()));
+                    return;
+                }
+                const size_t begin = (range - 1 - group_ranges) * RECORDING_RANGE_SIZE;
+                draw_objects(secondary, *world, begin, std::min(begin + RECORDING_RANGE_SIZE, object_draws_.size()));
+            }
+        );
+        vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(secondary_buffers.size()), secondary_buffers.data());
+    }
+
+    vkCmdEndRenderPass(command_buffer);
+
+    // Пирамида глубины для отсечения перекрытием следующего кадра
+    if (gpu_culler_) {
+        if (gpu_culling_ && frustum_culling_ && occlusion_culling_) {
+            hiz_->build(command_buffer, camera->get_view_projection_matrix());
+        } else {
+            hiz_->invalidate();
+        }
+    }
+
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record command buffer!");
+    }
+}
+
+void renderer::cull_objects(VkCommandBuffer command_buffer, const world& world, const camera& camera) {
+    const auto& objects = world.get_renderable_objects();
+    object_visible_.assign(objects.size(), 0);
+    
+    // Объекты от ближних к дальним: ранний тест глубины отбрасывает закрытые фрагменты
+    const vec3f camera_position = camera.get_position();
+    draw_order_keys_.clear();
+    for (size_t i = 0; i < objects.size(); i++) {
+        const world_object& obj = *objects[i];
+        if (!obj.visible || !obj.pmesh) continue;
+        
+        const vec3f offset = obj.get_world_bounds().center() - camera_position;
+        draw_order_keys_.emplace_back(math::length_squared(offset), static_cast<uint32>(i));
+    }
+    std::sort(draw_order_keys_.begin(), draw_order_keys_.end());
+    
+    // Меши арены мира при отсечении на GPU не проверяются на CPU
+    const auto gpu_arena = gpu_culler_ && gpu_culling_ && frustum_culling_ ? world.get_mesh_arena() : nullptr;
+    if (gpu_culler_) {
+        gpu_culler_->begin(current_frame_);
+    }
+    
+    cull_bounds_.clear();
+    cull_indices_.clear();
+    for (const auto& [distance, i] : draw_order_keys_) {
+        const world_object& obj = *objects[i];
+        
+        if (gpu_arena && obj.pmesh->get_arena() == gpu_arena.get() &&
+            obj.pmesh->get_format() == mesh_format::indexed && obj.pmesh->get_index_count() > 0) {
+            gpu_culler_->add(obj.get_world_bounds(), obj.transform, obj.pmesh->get_arena_range());
+        } else if (frustum_culling_) {
+            cull_bounds_.push_back(obj.get_world_bounds());
+            cull_indices_.push_back(i);
+        } else {
+            object_visible_[i] = 1;
+        }
+    }
+    
+    culled_object_count_ = 0;
+    if (!cull_indices_.empty() || (gpu_culler_ && gpu_culler_->get_object_count() > 0)) {
+        const frustum view_frustum(camera.get_view_projection_matrix());
+        if (gpu_culler_) {
+            hiz_->prepare(command_buffer);
+            gpu_culler_->dispatch(command_buffer, view_frustum, occlusion_culling_);
+        }
+        
+        // Проверка всех AABB одним проходом по плоскостям
+        cull_results_.resize(cull_indices_.size());
+        const size_t visible_count = view_frustum.test(cull_bounds_, cull_results_.data());
+        culled_object_count_ = cull_indices_.size() - visible_count;
+        
+        for (size_t i = 0; i < cull_indices_.size(); i++) {
+            object_visible_[cull_indices_[i]] = cull_results_[i];
+        }
+    }
+    
+    draw_order_.clear();
+    for (const auto& [distance, i] : draw_order_keys_) {
+        if (object_visible_[i]) draw_order_.push_back(i);
+    }
+}
+
+void renderer::prepare_instanced(const world& world) {
+    const auto& objects = world.get_renderable_objects();
+    
+    // draw_order_ - видимые объекты от ближних к дальним
+    auto is_instanced = [&objects](uint32 i) {
+        const world_object& obj = *objects[i];
+        return obj.pmesh->get_format() == mesh_format::indexed && obj.pmesh->get_index_count() > 0;
+    };
+    
+    // Группы объектов по мешу в порядке ближайшего объекта группы;
+    // матрицы группы лежат в буфере подряд, тоже от ближних к дальним
+    instance_groups_.clear();
+    instance_group_lookup_.clear();
+    group_draws_.clear();
+    indirect_commands_.clear();
+    uint32 instance_count = 0;
+    for (uint32 i : draw_order_) {
+        if (!is_instanced(i)) continue;
+        const auto& obj = objects[i];
+        
+        auto [it, inserted] = instance_group_lookup_.try_emplace(obj->pmesh.get(), static_cast<uint32>(instance_groups_.size()));
+        if (inserted) {
+            instance_groups_.push_back({obj->pmesh.get(), 0, 0, 0});
+        }
+        instance_groups_[it->second].instance_count++;
+        instance_count++;
+    }
+    if (instance_count == 0) return;
+    
+    uint32 first_instance = 0;
+    for (auto& group : instance_groups_) {
+        group.first_instance = first_instance;
+        first_instance += group.instance_count;
+    }
+    
+    object_transforms_.resize(instance_count);
+    for (uint32 i : draw_order_) {
+        if (!is_instanced(i)) continue;
+        const auto& obj = objects[i];
+        
+        instance_group& group = instance_groups_[instance_group_lookup_[obj->pmesh.get()]];
+        object_transform_data& transform_data = object_transforms_[group.first_instance + group.written++];
+        std::copy_n(obj->transform.get_matrix().ptr(), 16, transform_data.model);
+        std::copy_n(obj->transform.get_normal_matrix().ptr(), 12, transform_data.normal);
+    }
+    
+    ensure_instance_capacity(instance_count);
+    transform_buffers_[current_frame_]->copy_from(
+        object_transforms_.data(), object_transforms_.size() * sizeof(object_transform_data)
+    );
+    
+    // Меши арены мира - командами косвенной отрисовки, остальные группы - вызовом на меш
+    const auto arena = draw_indirect_ ? world.get_mesh_arena() : nullptr;
+    for (uint32 g = 0; g < instance_groups_.size(); g++) {
+        const instance_group& group = instance_groups_[g];
+        if (!arena || group.pmesh->get_arena() != arena.get()) {
+            group_draws_.push_back(g);
+            continue;
+        }
+        
+        const mesh_arena_range& range = group.pmesh->get_arena_range();
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = range.index_count;
+        command.instanceCount = group.instance_count;
+        command.firstIndex = range.first_index;
+        command.vertexOffset = static_cast<int32_t>(range.first_vertex);
+        command.firstInstance = group.first_instance;
+        indirect_commands_.push_back(command);
+    }
+    
+    if (!indirect_commands_.empty()) {
+        indirect_buffers_[current_frame_]->copy_from(
+            indirect_commands_.data(), indirect_commands_.size() * sizeof(VkDrawIndexedIndirectCommand)
+        );
+    }
+}
+
+void renderer::bind_instanced(VkCommandBuffer command_buffer) const {
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instanced_pipeline_);
+    VkDescriptorSet sets[] = {descriptor_sets_[current_frame_], transform_descriptor_sets_[current_frame_]};
+    vkCmdBindDescriptorSets(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        instanced_pipeline_layout_,
+        0,
+        2,
+        sets,
+        0,
+        nullptr
+    );
+}
+
+void renderer::draw_indirect(VkCommandBuffer command_buffer, const world& world) const {
+    if (indirect_commands_.empty()) return;
+    
+    // Меши арены мира - одним косвенным вызовом (частями по maxDrawIndirectCount)
+    bind_instanced(command_buffer);
+    world.get_mesh_arena()->bind(command_buffer);
+    
+    const uint32 draw_count = static_cast<uint32>(indirect_commands_.size());
+    for (uint32 first = 0; first < draw_count; first += max_draw_indirect_count_) {
+        vkCmdDrawIndexedIndirect(
+            command_buffer,
+            indirect_buffers_[current_frame_]->get_buffer(),
+            static_cast<VkDeviceSize>(first) * sizeof(VkDrawIndexedIndirectCommand),
+            std::min(max_draw_indirect_count_, draw_count - first),
+            sizeof(VkDrawIndexedIndirectCommand)
+        );
+    }
+}
+
+void renderer::draw_instance_groups(VkCommandBuffer command_buffer, size_t begin, size_t end) const {
+    if (begin >= end) return;
+    
+    // Вызов на меш; буферы общей арены привязываются один раз на участок
+    bind_instanced(command_buffer);
+    const mesh_arena* bound_arena = nullptr;
+    for (size_t i = begin; i < end; i++) {
+        const instance_group& group = instance_groups_[group_draws_[i]];
+        const mesh_arena* group_arena = group.pmesh->get_arena();
+        if (!group_arena || group_arena != bound_arena) {
+            group.pmesh->bind(command_buffer);
+            bound_arena = group_arena;
+        }
+        group.pmesh->draw_indexed(command_buffer, group.instance_count, group.first_instance);
+    }
+}
+
+void renderer::draw_gpu_culled(VkCommandBuffer command_buffer, const world& world) const {
+    // Меши арены, отсеченные на GPU: команды и их число записал compute шейдер
+    if (!gpu_culler_ || gpu_culler_->get_object_count() == 0) return;
+    
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instanced_pipeline_);
     vkCmdBindDescriptorSets(
-        command_buffers_[current_image_index_],
+        command_buffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipeline_layout_,
+        instanced_pipeline_layout_,
         0,
         1,
         &descriptor_sets_[current_frame_],
         0,
         nullptr
     );
+    world.get_mesh_arena()->bind(command_buffer);
+    gpu_culler_->draw(command_buffer, instanced_pipeline_layout_);
+}
 
-    // Рендерим все объекты в мире
-    const auto& objects = world->get_renderable_objects();
-    for (const auto& obj : objects) {
-        if (obj->visible && obj->pmesh) {
-            // Подготавливаем push constant данные с матрицей модели
-            push_constant_data push_data{};
-            const mat4f& model_matrix = obj->transform.get_matrix();
-            for (int i = 0; i < 16; i++) {
-                push_data.model[i] = model_matrix[i];
-            }
-            
-            // Отправляем push constants
-            vkCmdPushConstants(
-                command_buffers_[current_image_index_],
-                pipeline_layout_,
-                VK_SHADER_STAGE_VERTEX_BIT,
+void renderer::draw_objects(VkCommandBuffer command_buffer, const world& world, size_t begin, size_t end) const {
+    // Pipeline переключается по формату меша
+    VkPipeline bound_pipeline = VK_NULL_HANDLE;
+    const auto& objects = world.get_renderable_objects();
+    for (size_t i = begin; i < end; i++) {
+        const auto& obj = objects[object_draws_[i]];
+        
+        const bool quads = obj->pmesh->get_format() == mesh_format::quads;
+        VkPipeline pipeline = quads ? quad_pipeline_ : graphics_pipeline_;
+        VkPipelineLayout layout = quads ? quad_pipeline_layout_ : pipeline_layout_;
+        
+        if (pipeline != bound_pipeline) {
+            // Биндим pipeline и descriptor set с uniform buffer
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            vkCmdBindDescriptorSets(
+                command_buffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                layout,
+                0,
+                1,
+                &descriptor_sets_[current_frame_],
                 0,
-                sizeof(push_constant_data),
-                &push_data
+                nullptr
             );
-            
+            bound_pipeline = pipeline;
+        }
+        
+        // Подготавливаем push constant данные с матрицами модели и нормалей
+        push_constant_data push_data{};
+        std::copy_n(obj->transform.get_matrix().ptr(), 16, push_data.model);
+        std::copy_n(obj->transform.get_normal_matrix().ptr(), 12, push_data.normal);
+        
+        // Отправляем push constants
+        vkCmdPushConstants(
+            command_buffer,
+            layout,
+            VK_SHADER_STAGE_VERTEX_BIT,
+            0,
+            sizeof(push_constant_data),
+            &push_data
+        );
+        
+        if (quads) {
+            // Вершины строятся шейдером из буфера квадов
+            obj->pmesh->bind_quads(command_buffer, layout);
+            obj->pmesh->draw_quads(command_buffer);
+        } else {
             // Биндим меш объекта
-            obj->pmesh->bind(command_buffers_[current_image_index_]);
+            obj->pmesh->bind(command_buffer);
             
             // Рисуем меш с индексами
-            obj->pmesh->draw_indexed(command_buffers_[current_image_index_]);
+            obj->pmesh->draw_indexed(command_buffer);
         }
     }
+}
 
-    vkCmdEndRenderPass(command_buffers_[current_image_index_]);
-
-    if (vkEndCommandBuffer(command_buffers_[current_image_index_]) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to record command buffer!");
-    }
+void renderer::ensure_instance_capacity(size_t instance_count) {
+    if (instance_capacities_[current_frame_] >= instance_count) return;
+    
+    // Буферы этого кадра свободны: его fence дождались в begin_frame.
+    // Команд косвенной отрисовки не больше, чем экземпляров
+    const size_t capacity = std::max<size_t>({instance_count, instance_capacities_[current_frame_] * 2, 256});
+    transform_buffers_[current_frame_] = std::make_unique<storage_buffer>(
+        context_, capacity * sizeof(object_transform_data)
+    );
+    indirect_buffers_[current_frame_] = std::make_unique<indirect_buffer>(
+        context_, capacity * sizeof(VkDrawIndexedIndirectCommand)
+    );
+    instance_capacities_[current_frame_] = capacity;
+    VkDescriptorBufferInfo buffer_info{};
+    buffer_info.buffer = transform_buffers_[current_frame_]->get_buffer();
+    buffer_info.offset = 0;
+    buffer_info.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet descriptor_write{};
+    descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write.dstSet = transform_descriptor_sets_[current_frame_];
+    descriptor_write.dstBinding = 0;
+    descriptor_write.dstArrayElement = 0;
+    descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_write.descriptorCount = 1;
+    descriptor_write.pBufferInfo = &buffer_info;
+
+    vkUpdateDescriptorSets(context_->get_device(), 1, &descriptor_write, 0, nullptr);
 }
 
 void renderer::set_clear_color(const colorf& color) {
@@ -264,13 +657,27 @@ void renderer::set_clear_color(float r, float g, float b, float a) {
 
 void renderer::wait_idle() {
     vkDeviceWaitIdle(context_->get_device());
+    completed_frame_ = submitted_frame_;
 }
 
 void renderer::handle_resize() {
     framebuffer_resized_ = true;
 }
 
-void renderer::create_swapchain() {
+void renderer::set_recording_thread_count(size_t thread_count) {
+    // Пулы потоков могут быть заняты кадрами в полете
+    wait_idle();
+    recorder_.reset();
+    if (thread_count > 0) {
+        recorder_ = std::make_unique<command_recorder>(context_, MAX_FRAMES_IN_FLIGHT, thread_count);
+    }
+}
+
+size_t renderer::get_recording_thread_count() const {
+    return recorder_ ? recorder_->get_thread_count() : 0;
+}
+
+void renderer::create_swapchain(VkSwapchainKHR old_swapchain) {
     auto swapchain_support = context_->query_swapchain_support();
 
     VkSurfaceFormatKHR surface_format = choose_swap_surface_format(swapchain_support.formats);
@@ -296,7 +703,7 @@ void renderer::create_swapchain() {
     create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     create_info.presentMode = present_mode;
     create_info.clipped = VK_TRUE;
-    create_info.oldSwapchain = VK_NULL_HANDLE;
+    create_info.oldSwapchain = old_swapchain; // Изображения старого swapchain можно показать до замены
 
     auto queue_families = context_->get_queue_families();
     if (queue_families.graphics_family != queue_families.present_family) {
@@ -343,6 +750,73 @@ void renderer::create_image_views() {
     }
 }
 
+VkFormat renderer::find_depth_format() const {
+    // Глубина читается построением пирамиды перекрытия; D16_UNORM выборку поддерживает всегда
+    const VkFormat candidates[] = {
+        VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM
+    };
+    const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    for (VkFormat format : candidates) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(context_->get_physical_device(), format, &properties);
+        if ((properties.optimalTilingFeatures & features) == features) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("Failed to find supported depth format!");
+}
+
+void renderer::create_depth_resources() {
+    VkDevice device = context_->get_device();
+
+    VkImageCreateInfo image_info{};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = depth_format_;
+    image_info.extent = {swapchain_extent_.width, swapchain_extent_.height, 1};
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &image_info, nullptr, &depth_image_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth image!");
+    }
+
+    depth_allocation_ = context_->get_allocator().allocate_image(depth_image_, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkImageViewCreateInfo view_info{};
+    view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_info.image = depth_image_;
+    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    view_info.format = depth_format_;
+    view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    view_info.subresourceRange.baseMipLevel = 0;
+    view_info.subresourceRange.levelCount = 1;
+    view_info.subresourceRange.baseArrayLayer = 0;
+    view_info.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &view_info, nullptr, &depth_image_view_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth image view!");
+    }
+}
+
+void renderer::destroy_depth_resources() {
+    if (depth_image_view_ != VK_NULL_HANDLE) {
+        vkDestroyImageView(context_->get_device(), depth_image_view_, nullptr);
+        depth_image_view_ = VK_NULL_HANDLE;
+    }
+    if (depth_image_ != VK_NULL_HANDLE) {
+        vkDestroyImage(context_->get_device(), depth_image_, nullptr);
+        depth_image_ = VK_NULL_HANDLE;
+    }
+    context_->get_allocator().free(depth_allocation_);
+}
+
 void renderer::create_render_pass() {
     VkAttachmentDescription color_attachment{};
     color_attachment.format = swapchain_image_format_;
@@ -354,31 +828,59 @@ void renderer::create_render_pass() {
     color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
+    // Глубина после прохода читается построением пирамиды перекрытия
+    VkAttachmentDescription depth_attachment{};
+    depth_attachment.format = depth_format_;
+    depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depth_attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
     VkAttachmentReference color_attachment_ref{};
     color_attachment_ref.attachment = 0;
     color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    VkAttachmentReference depth_attachment_ref{};
+    depth_attachment_ref.attachment = 1;
+    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
     VkSubpassDescription subpass{};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &color_attachment_ref;
-
-    VkSubpassDependency dependency{};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
+    subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+    // Очистка глубины ждет записи глубины предыдущим кадром и её чтения пирамидой
+    std::array<VkSubpassDependency, 2> dependencies{};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // Пирамида читает глубину после прохода
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    std::array<VkAttachmentDescription, 2> attachments = {color_attachment, depth_attachment};
     VkRenderPassCreateInfo render_pass_info{};
     render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    render_pass_info.attachmentCount = 1;
-    render_pass_info.pAttachments = &color_attachment;
+    render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+    render_pass_info.pAttachments = attachments.data();
     render_pass_info.subpassCount = 1;
     render_pass_info.pSubpasses = &subpass;
-    render_pass_info.dependencyCount = 1;
-    render_pass_info.pDependencies = &dependency;
+    render_pass_info.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    render_pass_info.pDependencies = dependencies.data();
 
     if (vkCreateRenderPass(context_->get_device(), &render_pass_info, nullptr, &render_pass_) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create render pass!");
@@ -404,22 +906,61 @@ void renderer::create_descriptor_set_layout() {
 }
 
 void renderer::create_graphics_pipeline() {
-    // Используем уже созданные шейдеры
+    // Pipeline layout
+    VkPushConstantRange push_constant_range{};
+    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(push_constant_data);
+
+    VkPipelineLayoutCreateInfo pipeline_layout_info{};
+    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeline_layout_info.setLayoutCount = 1;
+    pipeline_layout_info.pSetLayouts = &descriptor_set_layout_;
+    pipeline_layout_info.pushConstantRangeCount = 1;
+    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+
+    if (vkCreatePipelineLayout(context_->get_device(), &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline layout!");
+    }
+
+    graphics_pipeline_ = create_pipeline(*vertex_shader_, true, pipeline_layout_);
+
+    // Layout pipeline квадов и экземпляров: uniform buffer (set 0) и storage buffer (set 1)
+    VkDescriptorSetLayout storage_set_layouts[] = {descriptor_set_layout_, context_->get_quad_set_layout()};
+    pipeline_layout_info.setLayoutCount = 2;
+    pipeline_layout_info.pSetLayouts = storage_set_layouts;
+
+    if (vkCreatePipelineLayout(context_->get_device(), &pipeline_layout_info, nullptr, &quad_pipeline_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create quad pipeline layout!");
+    }
+
+    quad_pipeline_ = create_pipeline(*quad_vertex_shader_, false, quad_pipeline_layout_);
+
+    if (vkCreatePipelineLayout(context_->get_device(), &pipeline_layout_info, nullptr, &instanced_pipeline_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create instanced pipeline layout!");
+    }
+
+    instanced_pipeline_ = create_pipeline(*instanced_vertex_shader_, true, instanced_pipeline_layout_);
+}
+
+VkPipeline renderer::create_pipeline(const shader& vertex_shader, bool vertex_input, VkPipelineLayout layout) {
     VkPipelineShaderStageCreateInfo shader_stages[] = {
-        vertex_shader_->get_stage_info(),
+        vertex_shader.get_stage_info(),
         fragment_shader_->get_stage_info()
     };
 
-    // Vertex input state
+    // Vertex input state; без вершинных буферов шейдер сам читает данные по gl_VertexIndex
     auto binding_description = vertex::get_binding_descriptions();
     auto attribute_descriptions = vertex::get_attribute_descriptions();
     
     VkPipelineVertexInputStateCreateInfo vertex_input_info{};
     vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_input_info.vertexBindingDescriptionCount = static_cast<uint32_t>(binding_description.size());
-    vertex_input_info.pVertexBindingDescriptions = binding_description.data();
-    vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size());
-    vertex_input_info.pVertexAttributeDescriptions = attribute_descriptions.data();
+    if (vertex_input) {
+        vertex_input_info.vertexBindingDescriptionCount = static_cast<uint32_t>(binding_description.size());
+        vertex_input_info.pVertexBindingDescriptions = binding_description.data();
+        vertex_input_info.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size());
+        vertex_input_info.pVertexAttributeDescriptions = attribute_descriptions.data();
+    }
 
     // Input assembly state
     VkPipelineInputAssemblyStateCreateInfo input_assembly{};
@@ -427,25 +968,18 @@ void renderer::create_graphics_pipeline() {
     input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     input_assembly.primitiveRestartEnable = VK_FALSE;
 
-    // Viewport state
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapchain_extent_.width);
-    viewport.height = static_cast<float>(swapchain_extent_.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = swapchain_extent_;
-
+    // Viewport state: viewport и scissor динамические (set_viewport), pipeline
+    // не зависит от размера swapchain и не пересоздается при изменении окна
     VkPipelineViewportStateCreateInfo viewport_state{};
     viewport_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewport_state.viewportCount = 1;
-    viewport_state.pViewports = &viewport;
     viewport_state.scissorCount = 1;
-    viewport_state.pScissors = &scissor;
+
+    const VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic_state{};
+    dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamic_state.dynamicStateCount = 2;
+    dynamic_state.pDynamicStates = dynamic_states;
 
     // Rasterizer state
     VkPipelineRasterizationStateCreateInfo rasterizer{};
@@ -464,6 +998,15 @@ void renderer::create_graphics_pipeline() {
     multisampling.sampleShadingEnable = VK_FALSE;
     multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
+    // Depth stencil state
+    VkPipelineDepthStencilStateCreateInfo depth_stencil{};
+    depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depth_stencil.depthTestEnable = VK_TRUE;
+    depth_stencil.depthWriteEnable = VK_TRUE;
+    depth_stencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depth_stencil.depthBoundsTestEnable = VK_FALSE;
+    depth_stencil.stencilTestEnable = VK_FALSE;
+
     // Color blend state
     VkPipelineColorBlendAttachmentState color_blend_attachment{};
     color_blend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -475,22 +1018,6 @@ void renderer::create_graphics_pipeline() {
     color_blending.attachmentCount = 1;
     color_blending.pAttachments = &color_blend_attachment;
 
-    // Pipeline layout
-    VkPushConstantRange push_constant_range{};
-    push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    push_constant_range.offset = 0;
-    push_constant_range.size = sizeof(push_constant_data);
-
-    VkPipelineLayoutCreateInfo pipeline_layout_info{};
-    pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeline_layout_info.setLayoutCount = 1;
-    pipeline_layout_info.pSetLayouts = &descriptor_set_layout_;
-    pipeline_layout_info.pushConstantRangeCount = 1;
-    pipeline_layout_info.pPushConstantRanges = &push_constant_range;
-
-    if (vkCreatePipelineLayout(context_->get_device(), &pipeline_layout_info, nullptr, &pipeline_layout_) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create pipeline layout!");
-    }
 
     // Graphics pipeline
     VkGraphicsPipelineCreateInfo pipeline_info{};
@@ -502,29 +1029,35 @@ void renderer::create_graphics_pipeline() {
     pipeline_info.pViewportState = &viewport_state;
     pipeline_info.pRasterizationState = &rasterizer;
     pipeline_info.pMultisampleState = &multisampling;
+    pipeline_info.pDepthStencilState = &depth_stencil;
     pipeline_info.pColorBlendState = &color_blending;
-    pipeline_info.layout = pipeline_layout_;
+    pipeline_info.pDynamicState = &dynamic_state;
+    pipeline_info.layout = layout;
     pipeline_info.renderPass = render_pass_;
     pipeline_info.subpass = 0;
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(context_->get_device(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &graphics_pipeline_) != VK_SUCCESS) {
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(context_->get_device(), context_->get_pipeline_cache(), 1, &pipeline_info, nullptr, &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create graphics pipeline!");
     }
+    return pipeline;
 }
 
 void renderer::create_framebuffers() {
     framebuffers_.resize(swapchain_image_views_.size());
 
     for (size_t i = 0; i < swapchain_image_views_.size(); i++) {
+        // Буфер глубины общий: кадры выполняются по очереди (зависимость render pass)
         VkImageView attachments[] = {
-            swapchain_image_views_[i]
+            swapchain_image_views_[i],
+            depth_image_view_
         };
 
         VkFramebufferCreateInfo framebuffer_info{};
         framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebuffer_info.renderPass = render_pass_;
-        framebuffer_info.attachmentCount = 1;
+        framebuffer_info.attachmentCount = 2;
         framebuffer_info.pAttachments = attachments;
         framebuffer_info.width = swapchain_extent_.width;
         framebuffer_info.height = swapchain_extent_.height;
@@ -556,6 +1089,7 @@ void renderer::create_sync_objects() {
     render_finished_semaphores_.resize(swapchain_images_.size());
     // Fences создаем по количеству кадров в полете
     in_flight_fences_.resize(MAX_FRAMES_IN_FLIGHT);
+    frame_serials_.resize(MAX_FRAMES_IN_FLIGHT, 0);
     // Инициализируем массив fences для изображений
     images_in_flight_.resize(swapchain_images_.size(), VK_NULL_HANDLE);
 
@@ -598,15 +1132,18 @@ void renderer::create_uniform_buffers() {
 }
 
 void renderer::create_descriptor_pool() {
-    VkDescriptorPoolSize pool_size{};
-    pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    pool_size.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    // Uniform buffer и storage buffer матриц экземпляров на каждый кадр в полете
+    VkDescriptorPoolSize pool_sizes[2]{};
+    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    pool_sizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_sizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
     VkDescriptorPoolCreateInfo pool_info{};
     pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    pool_info.poolSizeCount = 1;
-    pool_info.pPoolSizes = &pool_size;
-    pool_info.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+    pool_info.poolSizeCount = 2;
+    pool_info.pPoolSizes = pool_sizes;
+    pool_info.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT * 2);
 
     if (vkCreateDescriptorPool(context_->get_device(), &pool_info, nullptr, &descriptor_pool_) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create descriptor pool!");
@@ -643,20 +1180,42 @@ void renderer::create_descriptor_sets() {
 
         vkUpdateDescriptorSets(context_->get_device(), 1, &descriptor_write, 0, nullptr);
     }
+
+    // Наборы матриц экземпляров заполняются при создании буферов (ensure_instance_capacity)
+    std::vector<VkDescriptorSetLayout> transform_layouts(MAX_FRAMES_IN_FLIGHT, context_->get_quad_set_layout());
+    alloc_info.pSetLayouts = transform_layouts.data();
+
+    transform_descriptor_sets_.resize(MAX_FRAMES_IN_FLIGHT);
+    if (vkAllocateDescriptorSets(context_->get_device(), &alloc_info, transform_descriptor_sets_.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor sets!");
+    }
+
+    transform_buffers_.resize(MAX_FRAMES_IN_FLIGHT);
+    indirect_buffers_.resize(MAX_FRAMES_IN_FLIGHT);
+    instance_capacities_.assign(MAX_FRAMES_IN_FLIGHT, 0);
 }
 
-void renderer::cleanup_swapchain() {
+void renderer::destroy_swapchain_resources() {
     for (auto framebuffer : framebuffers_) {
         vkDestroyFramebuffer(context_->get_device(), framebuffer, nullptr);
     }
+    framebuffers_.clear();
 
     for (auto image_view : swapchain_image_views_) {
         vkDestroyImageView(context_->get_device(), image_view, nullptr);
     }
+    swapchain_image_views_.clear();
+
+    destroy_depth_resources();
+}
+
+void renderer::cleanup_swapchain() {
+    destroy_swapchain_resources();
 
     vkDestroySwapchainKHR(context_->get_device(), swapchain_, nullptr);
+    swapchain_ = VK_NULL_HANDLE;
 
-    // Очищаем семафоры при пересоздании swapchain
+    // Освобождаем объекты синхронизации
     for (auto semaphore : image_available_semaphores_) {
         vkDestroySemaphore(context_->get_device(), semaphore, nullptr);
     }
@@ -664,7 +1223,6 @@ void renderer::cleanup_swapchain() {
         vkDestroySemaphore(context_->get_device(), semaphore, nullptr);
     }
 
-    // Очищаем fences при пересоздании swapchain
     for (auto fence : in_flight_fences_) {
         vkDestroyFence(context_->get_device(), fence, nullptr);
     }
@@ -684,12 +1242,68 @@ void renderer::recreate_swapchain() {
 
     wait_idle();
 
-    cleanup_swapchain();
+    // Пересоздается только то, что зависит от размера: swapchain, его image views,
+    // буфер глубины с пирамидой перекрытия и framebuffers. Render pass и pipeline остаются - формат
+    // изображений выбирается из того же списка поверхности, а viewport динамический
+    destroy_swapchain_resources();
+
+    const size_t image_count = swapchain_images_.size();
+    VkSwapchainKHR old_swapchain = swapchain_;
+    create_swapchain(old_swapchain);
+    vkDestroySwapchainKHR(context_->get_device(), old_swapchain, nullptr);
 
-    create_swapchain();
     create_image_views();
+    create_depth_resources();
     create_framebuffers();
-    create_sync_objects(); // Пересоздаем семафоры для нового количества изображений
+
+    // Пирамида перекрытия - под новый буфер глубины
+    if (hiz_) {
+        hiz_->resize(depth_image_view_, swapchain_extent_);
+        gpu_culler_->set_depth_pyramid(*hiz_);
+    }
+
+    // Command buffers и семафоры по изображениям - только если их число изменилось
+    if (swapchain_images_.size() != image_count) {
+        recreate_image_resources();
+    }
+    images_in_flight_.assign(swapchain_images_.size(), VK_NULL_HANDLE);
+}
+
+void renderer::recreate_image_resources() {
+    vkFreeCommandBuffers(
+        context_->get_device(), context_->get_command_pool(),
+        static_cast<uint32_t>(command_buffers_.size()), command_buffers_.data()
+    );
+    create_command_buffers();
+
+    for (auto semaphore : render_finished_semaphores_) {
+        vkDestroySemaphore(context_->get_device(), semaphore, nullptr);
+    }
+    render_finished_semaphores_.assign(swapchain_images_.size(), VK_NULL_HANDLE);
+
+    VkSemaphoreCreateInfo semaphore_info{};
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    for (auto& semaphore : render_finished_semaphores_) {
+        if (vkCreateSemaphore(context_->get_device(), &semaphore_info, nullptr, &semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create synchronization objects for a frame!");
+        }
+    }
+}
+
+void renderer::set_viewport(VkCommandBuffer command_buffer) const {
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(swapchain_extent_.width);
+    viewport.height = static_cast<float>(swapchain_extent_.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = swapchain_extent_;
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
 }
 
 void renderer::update_uniform_buffer(const std::shared_ptr<camera>& camera) {
@@ -12,6 +12,8 @@ namespace {
                 return VK_SHADER_STAGE_VERTEX_BIT;
             case voxel::shader_type::FRAGMENT:
                 return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case voxel::shader_type::COMPUTE:
+                return VK_SHADER_STAGE_COMPUTE_BIT;
         }
         throw std::runtime_error("Unknown shader type");
     }
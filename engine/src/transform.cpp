@@ -1,16 +1,39 @@
+#include <atomic>
+
 #include <voxel/transform.h>
 #include <voxel/math_utils.h>
 
 namespace voxel {
 
+namespace {
+    std::atomic<uint64> next_transform_version{1};
+}
+
 const mat4f& transform::get_matrix() const {
     if (matrix_dirty) {
-        cached_matrix = math::transform_matrix(position_, rotation_, scale_);
-        matrix_dirty = false;
+        update_matrices();
     }
     return cached_matrix;
 }
 
+const mat4f& transform::get_normal_matrix() const {
+    if (matrix_dirty) {
+        update_matrices();
+    }
+    return cached_normal_matrix;
+}
+
+void transform::update_matrices() const {
+    cached_matrix = math::transform_matrix(position_, rotation_, scale_);
+    cached_normal_matrix = math::normal_matrix(cached_matrix);
+    matrix_dirty = false;
+}
+
+void transform::mark_dirty() const {
+    matrix_dirty = true;
+    version_ = next_transform_version.fetch_add(1, std::memory_order_relaxed);
+}
+
 void transform::set_position(const vec3f& pos) {
     position_ = pos;
     mark_dirty();
@@ -0,0 +1,244 @@
+#include <stdexcept>
+#include <cstring>
+
+#include <voxel/upload_queue.h>
+#include <voxel/vulkan_context.h>
+
+namespace voxel {
+
+namespace {
+    // Выравнивание областей кольца
+    constexpr VkDeviceSize RING_ALIGNMENT = 16;
+
+    inline VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+upload_queue::upload_queue(std::shared_ptr<vulkan_context> context, VkDeviceSize ring_size)
+    : context_(std::move(context)), command_pool_(VK_NULL_HANDLE), ring_data_(nullptr),
+      ring_size_(align_up(ring_size, RING_ALIGNMENT)) {
+
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.queueFamilyIndex = context_->get_queue_families().graphics_family.value();
+    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    if (vkCreateCommandPool(context_->get_device(), &pool_info, nullptr, &command_pool_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upload command pool");
+    }
+
+    ring_ = std::make_unique<buffer>(
+        context_,
+        ring_size_,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    ring_data_ = static_cast<uint8*>(ring_->map());
+}
+
+upload_queue::~upload_queue() {
+    flush();
+
+    VkDevice device = context_->get_device();
+    for (auto& pending : in_flight_) {
+        vkWaitForFences(device, 1, &pending->fence, VK_TRUE, UINT64_MAX);
+        free_.push_back(std::move(pending));
+    }
+    in_flight_.clear();
+
+    for (auto& recycled : free_) {
+        vkDestroyFence(device, recycled->fence, nullptr);
+    }
+    free_.clear();
+
+    // Command buffers освобождаются вместе с пулом
+    vkDestroyCommandPool(device, command_pool_, nullptr);
+    ring_.reset();
+}
+
+void upload_queue::upload(buffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset) {
+    if (size == 0) return;
+
+    VkBuffer src;
+    VkDeviceSize src_offset = 0;
+    std::unique_ptr<buffer> staging;
+
+    if (size > ring_size_) {
+        // Не помещается в кольцо - отдельный staging буфер, живущий до завершения пакета
+        staging = std::make_unique<buffer>(
+            context_,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        staging->copy_from(data, size);
+        staging->unmap();
+        src = staging->get_buffer();
+    } else {
+        // Выделение может отправить текущий пакет, поэтому пакет открываем после него
+        src_offset = allocate(size);
+        std::memcpy(ring_data_ + src_offset, data, size);
+        src = ring_->get_buffer();
+    }
+
+    if (!current_) {
+        begin_batch();
+    }
+    if (staging) {
+        current_->temporaries.push_back(std::move(staging));
+    } else if (!current_->uses_ring) {
+        current_->uses_ring = true;
+        ring_batches_++;
+    }
+
+    VkBufferCopy copy_region{};
+    copy_region.srcOffset = src_offset;
+    copy_region.dstOffset = dst_offset;
+    copy_region.size = size;
+    vkCmdCopyBuffer(current_->command_buffer, src, dst.get_buffer(), 1, &copy_region);
+
+    uploaded_bytes_ += size;
+}
+
+void upload_queue::flush() {
+    if (!current_) return;
+
+    // Копирования должны завершиться до чтения данных в последующих отправках очереди
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        current_->command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr
+    );
+
+    if (vkEndCommandBuffer(current_->command_buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to record upload command buffer");
+    }
+
+    VkSubmitInfo submit_info{};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &current_->command_buffer;
+
+    if (vkQueueSubmit(context_->get_graphics_queue(), 1, &submit_info, current_->fence) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit upload command buffer");
+    }
+
+    current_->ring_end = head_;
+    in_flight_.push_back(std::move(current_));
+}
+
+void upload_queue::collect() {
+    VkDevice device = context_->get_device();
+
+    // Пакеты одной очереди завершаются в порядке отправки
+    while (!in_flight_.empty() && vkGetFenceStatus(device, in_flight_.front()->fence) == VK_SUCCESS) {
+        completed_batch_ = in_flight_.front()->serial;
+        retire(*in_flight_.front());
+        free_.push_back(std::move(in_flight_.front()));
+        in_flight_.pop_front();
+    }
+}
+
+void upload_queue::begin_batch() {
+    if (!free_.empty()) {
+        current_ = std::move(free_.back());
+        free_.pop_back();
+    } else {
+        current_ = std::make_unique<batch>();
+
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool = command_pool_;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(context_->get_device(), &alloc_info, &current_->command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer");
+        }
+
+        VkFenceCreateInfo fence_info{};
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(context_->get_device(), &fence_info, nullptr, &current_->fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload fence");
+        }
+    }
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(current_->command_buffer, &begin_info) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin upload command buffer");
+    }
+    current_->serial = ++batch_serial_;
+}
+
+void upload_queue::retire(batch& completed) {
+    // Всё кольцо до конца пакета освобождено (предыдущие пакеты уже завершены).
+    // Пакеты без данных в кольце tail_ не двигают
+    if (completed.uses_ring) {
+        completed.uses_ring = false;
+        tail_ = completed.ring_end;
+        if (--ring_batches_ == 0) {
+            ring_in_use_ = false;
+        }
+    }
+
+    vkResetFences(context_->get_device(), 1, &completed.fence);
+    vkResetCommandBuffer(completed.command_buffer, 0);
+    completed.temporaries.clear();
+}
+
+bool upload_queue::try_allocate(VkDeviceSize size, VkDeviceSize& offset) {
+    if (!ring_in_use_) {
+        head_ = 0;
+        tail_ = 0;
+    }
+
+    if (head_ > tail_ || !ring_in_use_) {
+        // Свободны [head_, ring_size_) и [0, tail_)
+        if (ring_size_ - head_ >= size) {
+            offset = head_;
+        } else if (tail_ >= size) {
+            offset = 0; // Остаток в конце кольца пропускается до следующего круга
+        } else {
+            return false;
+        }
+    } else {
+        // Свободно [head_, tail_); при head_ == tail_ кольцо заполнено
+        if (tail_ - head_ < size) return false;
+        offset = head_;
+    }
+
+    head_ = offset + size;
+    ring_in_use_ = true;
+    return true;
+}
+
+VkDeviceSize upload_queue::allocate(VkDeviceSize size) {
+    size = align_up(size, RING_ALIGNMENT);
+
+    VkDeviceSize offset;
+    while (!try_allocate(size, offset)) {
+        // Кольцо заполнено: отправляем накопленное и ждем самый старый пакет
+        flush();
+        if (in_flight_.empty()) {
+            throw std::runtime_error("upload_queue: staging ring exhausted");
+        }
+        vkWaitForFences(context_->get_device(), 1, &in_flight_.front()->fence, VK_TRUE, UINT64_MAX);
+        collect();
+    }
+    return offset;
+}
+
+} // namespace voxel
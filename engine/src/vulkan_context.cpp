@@ -1,6 +1,8 @@
 #include <stdexcept>
 #include <iostream>
 #include <set>
+#include <algorithm>
+#include <cstring>
 
 #include <voxel/vulkan_context.h>
 #include <voxel/window.h>
@@ -62,9 +64,15 @@ vulkan_context::vulkan_context(std::shared_ptr<window> window) : window_(window)
     pick_physical_device();
     create_logical_device();
     create_command_pool();
+    create_quad_set_layout();
+    allocator_ = std::make_unique<gpu_allocator>(device_, physical_device_);
+    pipeline_cache_ = std::make_unique<pipeline_cache>(device_, physical_device_);
 }
 
 vulkan_context::~vulkan_context() {
+    pipeline_cache_.reset();
+    allocator_.reset();
+    vkDestroyDescriptorSetLayout(device_, quad_set_layout_, nullptr);
     vkDestroyCommandPool(device_, command_pool_, nullptr);
     vkDestroyDevice(device_, nullptr);
 #ifdef DEBUG
@@ -238,15 +246,36 @@ void vulkan_context::create_logical_device() {
         queue_create_infos.push_back(queue_create_info);
     }
 
+    // Необязательные возможности включаются, если устройство их поддерживает
+    VkPhysicalDeviceFeatures supported_features{};
+    vkGetPhysicalDeviceFeatures(physical_device_, &supported_features);
+
     VkPhysicalDeviceFeatures device_features{};
+    device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+    device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+    enabled_features_ = device_features;
+
+    // Необязательные расширения: число команд косвенной отрисовки из буфера (отсечение на GPU)
+    uint32 extension_count;
+    vkEnumerateDeviceExtensionProperties(physical_device_, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device_, nullptr, &extension_count, available_extensions.data());
+
+    std::vector<const char*> extensions = device_extensions_;
+    const bool draw_indirect_count = std::any_of(available_extensions.begin(), available_extensions.end(), [](const VkExtensionProperties& extension) {
+        return std::strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0;
+    });
+    if (draw_indirect_count) {
+        extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
 
     VkDeviceCreateInfo create_info{};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     create_info.queueCreateInfoCount = static_cast<uint32>(queue_create_infos.size());
     create_info.pQueueCreateInfos = queue_create_infos.data();
     create_info.pEnabledFeatures = &device_features;
-    create_info.enabledExtensionCount = static_cast<uint32>(device_extensions_.size());
-    create_info.ppEnabledExtensionNames = device_extensions_.data();
+    create_info.enabledExtensionCount = static_cast<uint32>(extensions.size());
+    create_info.ppEnabledExtensionNames = extensions.data();
 
 #ifdef DEBUG
     const std::vector<const char*> validation_layers = {"VK_LAYER_KHRONOS_validation"};
@@ -262,6 +291,12 @@ void vulkan_context::create_logical_device() {
 
     vkGetDeviceQueue(device_, queue_families_.graphics_family.value(), 0, &graphics_queue_);
     vkGetDeviceQueue(device_, queue_families_.present_family.value(), 0, &present_queue_);
+
+    if (draw_indirect_count) {
+        cmd_draw_indexed_indirect_count_ = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR")
+        );
+    }
 }
 
 void vulkan_context::create_command_pool() {
@@ -275,6 +310,23 @@ void vulkan_context::create_command_pool() {
     }
 }
 
+void vulkan_context::create_quad_set_layout() {
+    VkDescriptorSetLayoutBinding quad_binding{};
+    quad_binding.binding = 0;
+    quad_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    quad_binding.descriptorCount = 1;
+    quad_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layout_info{};
+    layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layout_info.bindingCount = 1;
+    layout_info.pBindings = &quad_binding;
+
+    if (vkCreateDescriptorSetLayout(device_, &layout_info, nullptr, &quad_set_layout_) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create quad descriptor set layout");
+    }
+}
+
 bool vulkan_context::is_device_suitable(VkPhysicalDevice device) {
     // Получаем свойства устройства
     VkPhysicalDeviceProperties device_properties;
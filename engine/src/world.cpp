@@ -1,29 +1,36 @@
+#include <algorithm>
+#include <stdexcept>
+#include <chrono>
+
 #include <voxel/world.h>
 #include <voxel/vulkan_context.h>
 #include <voxel/mesh.h>
-#include <chrono>
+#include <voxel/camera.h>
+#include <voxel/math_utils.h>
+#include <voxel/chunk_codec.h>
 
 namespace voxel {
 
-world::world(std::shared_ptr<vulkan_context> context) 
-    : context_(context), worker_running_(true) {
-    // Запускаем рабочий поток для генерации мешей
-    worker_thread_ = std::thread(&world::worker_thread_function, this);
+namespace {
+    // Смещения к соседям по направлениям граней: +X, -X, +Y, -Y, +Z, -Z
+    const chunk_coord FACE_OFFSETS[6] = {
+        chunk_coord(1, 0, 0), chunk_coord(-1, 0, 0),
+        chunk_coord(0, 1, 0), chunk_coord(0, -1, 0),
+        chunk_coord(0, 0, 1), chunk_coord(0, 0, -1)
+    };
 }
 
-world::~world() {
-    // Останавливаем рабочий поток
-    {
-        std::lock_guard<std::mutex> lock(task_mutex_);
-        worker_running_ = false;
-    }
-    task_cv_.notify_one();
-    
-    if (worker_thread_.joinable()) {
-        worker_thread_.join();
+world::world(std::shared_ptr<vulkan_context> context, size_t mesh_thread_count) 
+    : context_(context), mesh_workers_(mesh_thread_count) {
+    if (context_) {
+        uploads_ = std::make_unique<upload_queue>(context_);
     }
 }
 
+world::~world() {
+    // Пул потоков генерации мешей останавливается в своем деструкторе
+}
+
 object_id world::add_object(
     std::shared_ptr<model> model, 
     const vec3f& position,
@@ -36,13 +43,14 @@ object_id world::add_object(
     obj->transform.set_position(position);
     obj->transform.set_rotation(rotation);
     obj->transform.set_scale(scale);
+    obj->shared_mesh = true;
     
     // Добавляем в вектор и карту
     objects_.push_back(obj);
     object_map_[id] = obj;
     
-    // Запускаем асинхронную генерацию меша
-    update_object_mesh(obj);
+    // Меш модели строится один раз для всех её объектов
+    acquire_shared_mesh(*obj);
     
     return id;
 }
@@ -50,6 +58,13 @@ object_id world::add_object(
 void world::remove_object(object_id id) {
     auto it = object_map_.find(id);
     if (it != object_map_.end()) {
+        // Отменяем незавершенную генерацию меша
+        if (auto obj = it->second.lock()) {
+            cancel_object_mesh(*obj);
+            release_shared_mesh(*obj);
+            retire_mesh(std::move(obj->pmesh));
+        }
+        
         // Удаляем из карты
         object_map_.erase(it);
         
@@ -65,8 +80,21 @@ void world::remove_object(object_id id) {
 }
 
 void world::clear() {
+    for (auto& obj : objects_) {
+        cancel_object_mesh(*obj);
+        retire_mesh(std::move(obj->pmesh));
+    }
+    for (auto& [key, entry] : shared_meshes_) {
+        cancel_shared_mesh(entry);
+        retire_mesh(std::move(entry.pmesh));
+    }
+    shared_meshes_.clear();
+    pending_mesh_keys_.clear();
     objects_.clear();
     object_map_.clear();
+    chunks_.clear();
+    chunk_objects_.clear();
+    dirty_chunks_.clear();
 }
 
 std::shared_ptr<world_object> world::get_object(object_id id) {
@@ -131,8 +159,27 @@ void world::scale_object(object_id id, const vec3f& factor) {
 // Методы для работы с моделями
 void world::set_object_model(object_id id, std::shared_ptr<model> new_model) {
     if (auto obj = get_object(id)) {
+        if (obj->shared_mesh) {
+            // Старый меш остается до готовности меша новой модели
+            release_shared_mesh(*obj);
+            obj->pmodel = new_model;
+            acquire_shared_mesh(*obj);
+            return;
+        }
+        
         obj->pmodel = new_model;
         obj->mesh_dirty = true;
+        
+        // Меш старой модели больше не нужен
+        cancel_object_mesh(*obj);
+    }
+}
+
+void world::mark_model_dirty(const std::shared_ptr<model>& model) {
+    auto it = shared_meshes_.find(model.get());
+    if (it != shared_meshes_.end()) {
+        cancel_shared_mesh(it->second);
+        it->second.mesh_dirty = true;
     }
 }
 
@@ -157,17 +204,225 @@ bool world::is_object_visible(object_id id) const {
     return false;
 }
 
+// Методы для работы с чанками
+std::shared_ptr<chunk> world::create_chunk(const chunk_coord& coord) {
+    auto it = chunks_.find(coord);
+    if (it != chunks_.end()) {
+        return it->second;
+    }
+    return insert_chunk(coord, std::make_shared<model>(CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE, model_storage::sparse));
+}
+
+std::shared_ptr<chunk> world::insert_chunk(const chunk_coord& coord, std::shared_ptr<model> chunk_model) {
+    if (!chunk_model ||
+        chunk_model->width() != CHUNK_SIZE || chunk_model->height() != CHUNK_SIZE || chunk_model->depth() != CHUNK_SIZE) {
+        throw std::invalid_argument("world::insert_chunk: chunk model must be CHUNK_SIZE^3");
+    }
+    
+    auto it = chunks_.find(coord);
+    if (it != chunks_.end()) {
+        chunk_objects_.erase(it->second->object);
+        remove_object(it->second->object);
+        chunks_.erase(it);
+    }
+    
+    // Объект чанка добавляется без немедленной генерации: меш строится
+    // в update_meshes, когда известны все соседи
+    auto obj = std::make_shared<world_object>(get_next_object_id(), chunk_model);
+    obj->transform.set_position(vec3f(
+        static_cast<float>(coord.x * CHUNK_SIZE),
+        static_cast<float>(coord.y * CHUNK_SIZE),
+        static_cast<float>(coord.z * CHUNK_SIZE)
+    ));
+    objects_.push_back(obj);
+    object_map_[obj->id] = obj;
+    
+    auto pchunk = std::make_shared<chunk>(coord, chunk_model);
+    pchunk->object = obj->id;
+    chunks_.emplace(coord, pchunk);
+    chunk_objects_.emplace(pchunk->object, coord);
+    
+    // Новый чанк закрывает грани соседей на стыке
+    mark_chunk_mesh_dirty(coord);
+    for (const chunk_coord& offset : FACE_OFFSETS) {
+        mark_chunk_mesh_dirty(coord + offset);
+    }
+    return pchunk;
+}
+
+void world::remove_chunk(const chunk_coord& coord) {
+    auto it = chunks_.find(coord);
+    if (it != chunks_.end()) {
+        chunk_objects_.erase(it->second->object);
+        remove_object(it->second->object);
+        chunks_.erase(it);
+        
+        // Грани соседей на стыке с удаленным чанком снова открыты
+        for (const chunk_coord& offset : FACE_OFFSETS) {
+            mark_chunk_mesh_dirty(coord + offset);
+        }
+    }
+}
+
+std::shared_ptr<chunk> world::get_chunk(const chunk_coord& coord) const {
+    auto it = chunks_.find(coord);
+    if (it != chunks_.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
+void world::set_block(int x, int y, int z, const voxel& voxel) {
+    const chunk_coord coord = block_to_chunk(x, y, z);
+    auto pchunk = get_chunk(coord);
+    if (!pchunk) {
+        if (voxel.is_empty()) return;
+        pchunk = create_chunk(coord);
+    }
+    
+    if (pchunk->is_cold()) {
+        warm_chunk(*pchunk);
+    }
+    
+    auto obj = get_object(pchunk->object);
+    if (obj && obj->mesh_future.valid()) {
+        // Модель читается задачей генерации - отменяем её и правим копию
+        cancel_object_mesh(*obj);
+        pchunk->pmodel = std::make_shared<model>(*pchunk->pmodel);
+        obj->pmodel = pchunk->pmodel;
+    }
+    
+    const int lx = x & CHUNK_MASK, ly = y & CHUNK_MASK, lz = z & CHUNK_MASK;
+    const bool was_empty = pchunk->pmodel->get_voxel_unchecked(lx, ly, lz).is_empty();
+    pchunk->pmodel->set_voxel(lx, ly, lz, voxel);
+    pchunk->save_dirty = true;
+    mark_chunk_mesh_dirty(coord);
+    
+    // Занятость граничного блока видна соседнему чанку
+    if (was_empty != voxel.is_empty()) {
+        if (lx == CHUNK_MASK) mark_chunk_mesh_dirty(coord + FACE_OFFSETS[0]);
+        if (lx == 0)          mark_chunk_mesh_dirty(coord + FACE_OFFSETS[1]);
+        if (ly == CHUNK_MASK) mark_chunk_mesh_dirty(coord + FACE_OFFSETS[2]);
+        if (ly == 0)          mark_chunk_mesh_dirty(coord + FACE_OFFSETS[3]);
+        if (lz == CHUNK_MASK) mark_chunk_mesh_dirty(coord + FACE_OFFSETS[4]);
+        if (lz == 0)          mark_chunk_mesh_dirty(coord + FACE_OFFSETS[5]);
+    }
+}
+
+voxel world::get_block(int x, int y, int z) const {
+    auto chunk_model = get_chunk_model(block_to_chunk(x, y, z));
+    if (!chunk_model) {
+        return voxel();
+    }
+    return chunk_model->get_voxel_unchecked(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK);
+}
+
+bool world::set_chunk_cold(const chunk_coord& coord, bool cold) {
+    auto pchunk = get_chunk(coord);
+    if (!pchunk) return false;
+    if (pchunk->is_cold() == cold) return true;
+    
+    if (!cold) {
+        warm_chunk(*pchunk);
+        return true;
+    }
+    
+    // Модель нужна, пока меш чанка не построен
+    auto obj = get_object(pchunk->object);
+    if (pchunk->mesh_dirty || (obj && (obj->mesh_dirty || obj->mesh_future.valid()))) {
+        return false;
+    }
+    
+    pchunk->cold_data = chunk_codec::encode(*pchunk->pmodel);
+    pchunk->pmodel.reset();
+    if (obj) {
+        obj->pmodel.reset();
+    }
+    return true;
+}
+
+std::shared_ptr<const model> world::get_chunk_model(const chunk_coord& coord) const {
+    auto pchunk = get_chunk(coord);
+    if (!pchunk) return nullptr;
+    if (pchunk->is_cold()) {
+        return chunk_codec::decode(pchunk->cold_data);
+    }
+    return pchunk->pmodel;
+}
+
+void world::mark_chunk_dirty(const chunk_coord& coord) {
+    if (auto pchunk = get_chunk(coord)) {
+        pchunk->save_dirty = true;
+    }
+    mark_chunk_mesh_dirty(coord);
+    for (const chunk_coord& offset : FACE_OFFSETS) {
+        mark_chunk_mesh_dirty(coord + offset);
+    }
+}
+
+std::vector<chunk_snapshot> world::take_unsaved_chunks() {
+    std::vector<chunk_snapshot> snapshots;
+    for (auto& [coord, pchunk] : chunks_) {
+        if (!pchunk->save_dirty) continue;
+        
+        pchunk->save_dirty = false;
+        snapshots.emplace_back(coord, pchunk->is_cold()
+            ? chunk_codec::decode(pchunk->cold_data)
+            : std::make_shared<const model>(*pchunk->pmodel));
+    }
+    return snapshots;
+}
+
+void world::mark_chunk_mesh_dirty(const chunk_coord& coord) {
+    auto pchunk = get_chunk(coord);
+    if (pchunk && !pchunk->mesh_dirty) {
+        pchunk->mesh_dirty = true;
+        dirty_chunks_.push_back(coord);
+    }
+}
+
 // Методы для рендеринга
 void world::update_meshes() {
     // Обрабатываем завершенные задачи генерации мешей
     process_completed_meshes();
     
+    // Пересортировываем ожидающие задачи, если камера сдвинулась
+    update_mesh_priorities();
+    
+    // Правки чанков за кадр собираются в одну задачу на чанк
+    flush_dirty_chunks();
+    
     // Запускаем генерацию для объектов с mesh_dirty = true
     for (auto& obj : objects_) {
         if (obj->mesh_dirty) {
             update_object_mesh(obj);
         }
     }
+    
+    // И для общих мешей измененных моделей
+    for (auto& [key, entry] : shared_meshes_) {
+        if (entry.mesh_dirty) {
+            update_shared_mesh(entry);
+        }
+    }
+    
+    if (shared_meshes_changed_) {
+        assign_shared_meshes();
+    }
+}
+
+void world::set_mesh_cache_limits(size_t memory_limit, size_t entry_limit) {
+    mesh_cache_.set_limits(memory_limit, entry_limit);
+}
+
+void world::set_mesh_arena_enabled(bool enabled) {
+    if (!enabled) {
+        // Меши в арене держат её до своего пересоздания
+        arena_.reset();
+    } else if (!arena_ && context_) {
+        arena_ = std::make_shared<mesh_arena>(context_);
+        arena_->advance_frame(frame_, completed_frame_);
+    }
 }
 
 // Утилиты
@@ -178,87 +433,452 @@ bool world::object_exists(object_id id) const {
 // Внутренние методы
 void world::mark_object_mesh_dirty(object_id id) {
     if (auto obj = get_object(id)) {
+        if (obj->shared_mesh) {
+            mark_model_dirty(obj->pmodel);
+            return;
+        }
         obj->mesh_dirty = true;
+        cancel_object_mesh(*obj);
     }
 }
 
 void world::update_object_mesh(std::shared_ptr<world_object> obj) {
     if (!obj || !context_ || !obj->pmodel || obj->mesh_dirty == false) return;
     
+    // Предыдущая задача объекта устарела - отменяем её
+    cancel_object_mesh(*obj);
+    
+    // Меш чанка отсекает грани, закрытые соседними чанками
+    std::shared_ptr<const mesh_borders> borders;
+    auto chunk_it = chunk_objects_.find(obj->id);
+    if (chunk_it != chunk_objects_.end()) {
+        borders = capture_chunk_borders(chunk_it->second);
+    }
+    
+    // Такой же меш уже построен или строится задачей другого объекта
+    obj->mesh_dirty = false;
+    if (mesh_cache_.is_enabled()) {
+        const mesh_cache_key key = mesh_cache::make_key(*obj->pmodel, borders.get(), mesh_format_);
+        if (auto cached = mesh_cache_.find(key)) {
+            set_mesh(obj->pmesh, std::move(cached));
+            return;
+        }
+        obj->mesh_key = key;
+        if (pending_mesh_keys_.count(key)) {
+            obj->waits_mesh_cache = true;
+            return;
+        }
+        pending_mesh_keys_.insert(key);
+    }
+    
     // Создаем задачу генерации меша
     auto task = std::make_unique<mesh_generation_task>(obj->id, obj->pmodel);
+    task->priority = compute_mesh_priority(*obj);
+    task->format = mesh_format_;
+    task->borders = std::move(borders);
     auto future = task->promise.get_future();
     
-    // Сохраняем future в объекте
+    // Сохраняем future и токен отмены в объекте
     obj->mesh_future = std::move(future);
+    obj->mesh_cancel = task->cancelled;
     
-    // Добавляем задачу в очередь
-    {
-        std::lock_guard<std::mutex> lock(task_mutex_);
-        task_queue_.push(std::move(task));
+    // Отправляем задачу в пул потоков
+    mesh_workers_.submit(std::move(task));
+}
+
+void world::cancel_object_mesh(world_object& obj) {
+    if (obj.mesh_cancel) {
+        obj.mesh_cancel->store(true, std::memory_order_relaxed);
+        obj.mesh_cancel.reset();
     }
-    task_cv_.notify_one();
     
-    // Помечаем объект как ожидающий генерации меша
-    obj->mesh_dirty = false;
+    // Ожидающие этот ключ объекты запустят свою задачу
+    if (obj.mesh_key && obj.mesh_future.valid()) {
+        pending_mesh_keys_.erase(*obj.mesh_key);
+    }
+    obj.mesh_key.reset();
+    obj.waits_mesh_cache = false;
+    
+    // Future отмененной задачи вернет broken_promise - не ждем его,
+    // чтобы не сбросить текущий меш объекта
+    obj.mesh_future = std::future<mesh_data>();
 }
 
-void world::worker_thread_function() {
-    while (true) {
-        std::unique_ptr<mesh_generation_task> task;
-        
-        // Ждем задачи
-        {
-            std::unique_lock<std::mutex> lock(task_mutex_);
-            task_cv_.wait(lock, [this] { 
-                return !task_queue_.empty() || !worker_running_; 
-            });
-            
-            if (!worker_running_ && task_queue_.empty()) {
+void world::acquire_shared_mesh(world_object& obj) {
+    // Собственной генерации у объекта нет - меш приходит из общего
+    obj.mesh_dirty = false;
+    if (!obj.pmodel) {
+        set_mesh(obj.pmesh, nullptr);
+        return;
+    }
+    
+    shared_model_mesh& entry = shared_meshes_[obj.pmodel.get()];
+    entry.pmodel = obj.pmodel;
+    entry.owner = obj.id;
+    entry.ref_count++;
+    
+    if (!entry.pmesh && entry.mesh_dirty) {
+        update_shared_mesh(entry);
+    }
+    if (entry.pmesh) {
+        set_mesh(obj.pmesh, entry.pmesh);
+    }
+}
+
+void world::release_shared_mesh(world_object& obj) {
+    if (!obj.shared_mesh) return;
+    
+    auto it = shared_meshes_.find(obj.pmodel.get());
+    if (it == shared_meshes_.end()) return;
+    
+    // Последний объект модели - меш больше не нужен (GPU данные живут, пока меш держат объекты)
+    if (--it->second.ref_count == 0) {
+        cancel_shared_mesh(it->second);
+        retire_mesh(std::move(it->second.pmesh));
+        shared_meshes_.erase(it);
+        return;
+    }
+    
+    // Приоритет генерации считается по объекту, который остается с этой моделью
+    if (it->second.owner == obj.id) {
+        for (const auto& other : objects_) {
+            if (other->id != obj.id && other->shared_mesh && other->pmodel == obj.pmodel) {
+                it->second.owner = other->id;
                 break;
             }
-            
-            if (!task_queue_.empty()) {
-                task = std::move(task_queue_.front());
-                task_queue_.pop();
-            }
         }
-        
-        if (task) {
-            try {
-                // Генерируем данные меша в отдельном потоке (без Vulkan буферов)
-                mesh_data data = greedy_mesh_generator::generate_mesh_data(task->pmodel);
-                
-                // Возвращаем результат
-                task->promise.set_value(std::move(data));
-            } catch (const std::exception& e) {
-                // В случае ошибки возвращаем пустые данные
-                task->promise.set_value(mesh_data());
-            }
+    }
+}
+
+void world::update_shared_mesh(shared_model_mesh& entry) {
+    entry.mesh_dirty = false;
+    if (!context_) return;
+    
+    cancel_shared_mesh(entry);
+    
+    // Одинаковые модели в разных объектах model мешатся один раз
+    if (mesh_cache_.is_enabled()) {
+        const mesh_cache_key key = mesh_cache::make_key(*entry.pmodel, nullptr, mesh_format_);
+        if (auto cached = mesh_cache_.find(key)) {
+            set_mesh(entry.pmesh, std::move(cached));
+            shared_meshes_changed_ = true;
+            return;
         }
+        entry.mesh_key = key;
+        if (pending_mesh_keys_.count(key)) {
+            entry.waits_mesh_cache = true;
+            return;
+        }
+        pending_mesh_keys_.insert(key);
     }
+    
+    auto task = std::make_unique<mesh_generation_task>(entry.owner, entry.pmodel);
+    auto owner = get_object(entry.owner);
+    task->priority = owner ? compute_mesh_priority(*owner) : 0.0f;
+    task->format = mesh_format_;
+    
+    entry.mesh_future = task->promise.get_future();
+    entry.mesh_cancel = task->cancelled;
+    mesh_workers_.submit(std::move(task));
+}
+
+void world::cancel_shared_mesh(shared_model_mesh& entry) {
+    if (entry.mesh_cancel) {
+        entry.mesh_cancel->store(true, std::memory_order_relaxed);
+        entry.mesh_cancel.reset();
+    }
+    if (entry.mesh_key && entry.mesh_future.valid()) {
+        pending_mesh_keys_.erase(*entry.mesh_key);
+    }
+    entry.mesh_key.reset();
+    entry.waits_mesh_cache = false;
+    entry.mesh_future = std::future<mesh_data>();
+}
+
+void world::assign_shared_meshes() {
+    shared_meshes_changed_ = false;
+    
+    // Готовый меш модели получают все её объекты
+    for (auto& obj : objects_) {
+        if (!obj->shared_mesh) continue;
+        auto it = shared_meshes_.find(obj->pmodel.get());
+        if (it != shared_meshes_.end() && !it->second.mesh_future.valid() && !it->second.waits_mesh_cache) {
+            set_mesh(obj->pmesh, it->second.pmesh);
+        }
+    }
+}
+
+void world::set_mesh(std::shared_ptr<mesh>& slot, std::shared_ptr<mesh> pmesh) {
+    if (slot != pmesh) {
+        retire_mesh(std::move(slot));
+    }
+    slot = std::move(pmesh);
+}
+
+void world::retire_mesh(std::shared_ptr<mesh> pmesh) {
+    // Откладывается и меш, который еще держат кэш или другие объекты:
+    // они могут отпустить его раньше, чем GPU закончит его читать
+    if (pmesh) {
+        const uint64 upload_batch = uploads_ ? uploads_->get_last_batch() : 0;
+        retired_meshes_.push_back({std::move(pmesh), frame_, upload_batch});
+    }
+}
+
+void world::set_frame_progress(uint64 frame, uint64 completed_frame) {
+    frame_ = frame;
+    completed_frame_ = completed_frame;
+    
+    // Участки арены, которые больше не читает GPU
+    if (arena_) {
+        arena_->advance_frame(frame_, completed_frame_);
+    }
+}
+
+void world::release_retired_meshes() {
+    // Кадры, которые могли читать меш, и пакеты загрузки, писавшие в него, завершены
+    const uint64 completed_batch = uploads_ ? uploads_->get_completed_batch() : 0;
+    retired_meshes_.erase(
+        std::remove_if(retired_meshes_.begin(), retired_meshes_.end(), [this, completed_batch](const retired_mesh& retired) {
+            return retired.frame <= completed_frame_ && retired.upload_batch <= completed_batch;
+        }),
+        retired_meshes_.end()
+    );
+}
+
+std::shared_ptr<mesh> world::create_mesh(mesh_data&& data, const std::optional<mesh_cache_key>& key, size_t& uploaded) {
+    uploaded += data.get_byte_size();
+    
+    auto pmesh = std::make_shared<mesh>(context_);
+    pmesh->set_mesh_data(data, arena_, *uploads_);
+    
+    if (key) {
+        pending_mesh_keys_.erase(*key);
+        mesh_cache_.insert(*key, pmesh, data.get_byte_size());
+        completed_meshes_[*key] = pmesh;
+    }
+    return pmesh;
+}
+
+bool world::resolve_cached_mesh(const mesh_cache_key& key, std::shared_ptr<mesh>& pmesh) {
+    // Меш построен в этом кадре (мог сразу вытесниться из кэша) или лежит в кэше
+    auto it = completed_meshes_.find(key);
+    if (it != completed_meshes_.end()) {
+        set_mesh(pmesh, it->second);
+        return true;
+    }
+    if (auto cached = mesh_cache_.find(key)) {
+        set_mesh(pmesh, std::move(cached));
+        return true;
+    }
+    return false;
 }
 
 void world::process_completed_meshes() {
+    if (!uploads_) return; // Без Vulkan контекста меши не строятся
+    
+    size_t uploaded = 0;
+    completed_meshes_.clear();
+    
+    // Освобождаем место staging кольца, занятое завершенными загрузками
+    uploads_->collect();
+    
+    // Отложенные меши, которые больше не читают ни кадры, ни загрузки
+    release_retired_meshes();
+    
+    // Бюджет кадра исчерпан - остальные меши загрузим в следующих кадрах
+    auto budget_exhausted = [this, &uploaded]() {
+        return mesh_upload_budget_ > 0 && uploaded >= mesh_upload_budget_;
+    };
+    
     // Проверяем завершенные задачи генерации мешей
     for (auto& obj : objects_) {
         if (obj->mesh_future.valid()) {
             // Проверяем, готов ли результат
             if (obj->mesh_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                if (budget_exhausted()) break;
+                
                 try {
-                    // Получаем данные меша
+                    // Получаем данные меша и создаем меш
                     mesh_data data = obj->mesh_future.get();
-                    
-                    // Создаем меш из данных
-                    obj->pmesh = std::make_shared<mesh>(context_);
-                    obj->pmesh->set_mesh_data(data);
+                    obj->mesh_cancel.reset();
+                    set_mesh(obj->pmesh, create_mesh(std::move(data), obj->mesh_key, uploaded));
                 } catch (const std::exception& e) {
                     // Если генерация не удалась, очищаем меш
-                    obj->pmesh = nullptr;
+                    set_mesh(obj->pmesh, nullptr);
+                    if (obj->mesh_key) {
+                        pending_mesh_keys_.erase(*obj->mesh_key);
+                        completed_meshes_[*obj->mesh_key] = nullptr;
+                    }
                 }
+                obj->mesh_key.reset();
+            }
+        }
+    }
+    
+    // Общие меши моделей
+    for (auto& [key, entry] : shared_meshes_) {
+        if (!entry.mesh_future.valid() ||
+            entry.mesh_future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            continue;
+        }
+        if (budget_exhausted()) break;
+        
+        try {
+            mesh_data data = entry.mesh_future.get();
+            entry.mesh_cancel.reset();
+            set_mesh(entry.pmesh, create_mesh(std::move(data), entry.mesh_key, uploaded));
+        } catch (const std::exception& e) {
+            set_mesh(entry.pmesh, nullptr);
+            if (entry.mesh_key) {
+                pending_mesh_keys_.erase(*entry.mesh_key);
+                completed_meshes_[*entry.mesh_key] = nullptr;
+            }
+        }
+        entry.mesh_key.reset();
+        shared_meshes_changed_ = true;
+    }
+    
+    // Ожидающие готового меша с тем же ключом; если задачу отменили, а меша нет -
+    // строим сами
+    for (auto& obj : objects_) {
+        if (!obj->waits_mesh_cache) continue;
+        
+        if (resolve_cached_mesh(*obj->mesh_key, obj->pmesh)) {
+            obj->waits_mesh_cache = false;
+            obj->mesh_key.reset();
+        } else if (!pending_mesh_keys_.count(*obj->mesh_key)) {
+            obj->waits_mesh_cache = false;
+            obj->mesh_key.reset();
+            obj->mesh_dirty = true;
+        }
+    }
+    for (auto& [key, entry] : shared_meshes_) {
+        if (!entry.waits_mesh_cache) continue;
+        
+        if (resolve_cached_mesh(*entry.mesh_key, entry.pmesh)) {
+            entry.waits_mesh_cache = false;
+            entry.mesh_key.reset();
+            shared_meshes_changed_ = true;
+        } else if (!pending_mesh_keys_.count(*entry.mesh_key)) {
+            entry.waits_mesh_cache = false;
+            entry.mesh_key.reset();
+            entry.mesh_dirty = true;
+        }
+    }
+    completed_meshes_.clear();
+    
+    // Все меши кадра - одной отправкой; отрисовка идет в той же очереди после неё
+    uploads_->flush();
+}
+
+void world::flush_dirty_chunks() {
+    for (const chunk_coord& coord : dirty_chunks_) {
+        auto pchunk = get_chunk(coord);
+        if (pchunk && pchunk->mesh_dirty) {
+            pchunk->mesh_dirty = false;
+            if (pchunk->is_cold()) {
+                warm_chunk(*pchunk);
             }
+            mark_object_mesh_dirty(pchunk->object);
         }
     }
+    dirty_chunks_.clear();
 }
 
-} 
\ No newline at end of file
+std::shared_ptr<const mesh_borders> world::capture_chunk_borders(const chunk_coord& coord) const {
+    auto pchunk = get_chunk(coord);
+    if (!pchunk || pchunk->is_cold()) return nullptr;
+    
+    // Слои копируются в основном потоке - задача не читает модели соседей
+    auto borders = std::make_shared<mesh_borders>();
+    for (int face = 0; face < 6; face++) {
+        if (auto neighbor_model = get_chunk_model(coord + FACE_OFFSETS[face])) {
+            borders->set_face(*pchunk->pmodel, face, *neighbor_model);
+        }
+    }
+    return borders;
+}
+
+void world::warm_chunk(chunk& target) {
+    target.pmodel = chunk_codec::decode(target.cold_data);
+    target.cold_data = std::vector<uint8>();
+    if (auto obj = get_object(target.object)) {
+        obj->pmodel = target.pmodel;
+    }
+}
+
+const aabb& world_object::get_world_bounds() const {
+    const model* current_model = pmodel.get();
+    const vec3i size = current_model
+        ? vec3i(current_model->width(), current_model->height(), current_model->depth())
+        : vec3i();
+    if (bounds_version_ == transform.get_version() && bounds_model_ == current_model && bounds_size_ == size) {
+        return bounds_;
+    }
+
+    // Центр модели переносится матрицей, полуразмеры - модулями её элементов
+    const mat4f& m = transform.get_matrix();
+    const vec3f half_size(size.x * 0.5f, size.y * 0.5f, size.z * 0.5f);
+    const vec3f center = math::transform_point(m, half_size);
+    const vec3f extent(
+        std::abs(m(0, 0)) * half_size.x + std::abs(m(1, 0)) * half_size.y + std::abs(m(2, 0)) * half_size.z,
+        std::abs(m(0, 1)) * half_size.x + std::abs(m(1, 1)) * half_size.y + std::abs(m(2, 1)) * half_size.z,
+        std::abs(m(0, 2)) * half_size.x + std::abs(m(1, 2)) * half_size.y + std::abs(m(2, 2)) * half_size.z
+    );
+    bounds_ = {center - extent, center + extent};
+
+    bounds_version_ = transform.get_version();
+    bounds_model_ = current_model;
+    bounds_size_ = size;
+    return bounds_;
+}
+
+float world::compute_mesh_priority(const world_object& obj) const {
+    if (!camera_ || !obj.pmodel) return 0.0f;
+    
+    // Ограничивающая сфера объекта в мировых координатах
+    vec3f half_size(
+        obj.pmodel->width() * 0.5f,
+        obj.pmodel->height() * 0.5f,
+        obj.pmodel->depth() * 0.5f
+    );
+    vec3f center = math::transform_point(obj.transform.get_matrix(), half_size);
+    const vec3f& scale = obj.transform.get_scale();
+    float radius = math::length(vec3f(
+        half_size.x * std::abs(scale.x),
+        half_size.y * std::abs(scale.y),
+        half_size.z * std::abs(scale.z)
+    ));
+    
+    // Отношение радиуса к расстоянию - оценка размера объекта на экране
+    vec3f to_object = center - camera_->get_position();
+    float distance = std::max(math::length(to_object), 0.001f);
+    float priority = radius / distance;
+    
+    // Объекты позади камеры откладываем
+    if (distance > radius && math::dot(to_object, camera_->get_forward()) < 0.0f) {
+        priority *= 0.25f;
+    }
+    
+    return priority;
+}
+
+void world::update_mesh_priorities() {
+    if (!camera_ || mesh_workers_.get_pending_count() == 0) return;
+    
+    vec3f position = camera_->get_position();
+    vec3f forward = camera_->get_forward();
+    if (math::length(position - priority_camera_position_) < PRIORITY_REFRESH_DISTANCE &&
+        math::dot(forward, priority_camera_forward_) > PRIORITY_REFRESH_COS_ANGLE) {
+        return;
+    }
+    priority_camera_position_ = position;
+    priority_camera_forward_ = forward;
+    
+    mesh_workers_.reprioritize([this](const mesh_generation_task& task) {
+        auto obj = get_object(task.id);
+        return obj ? compute_mesh_priority(*obj) : 0.0f;
+    });
+}
+
+}
@@ -0,0 +1,133 @@
+#include <iostream>
+
+#include <voxel/world_storage.h>
+#include <voxel/world.h>
+#include <voxel/chunk_codec.h>
+
+namespace voxel {
+
+world_storage::world_storage(const std::string& name, const std::filesystem::path& root)
+    : path_(root / name), last_autosave_(std::chrono::steady_clock::now()) {
+    std::filesystem::create_directories(path_);
+    writer_ = std::thread(&world_storage::writer_function, this);
+}
+
+world_storage::~world_storage() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    writer_cv_.notify_all();
+    writer_.join();
+}
+
+std::shared_ptr<model> world_storage::load_chunk(const chunk_coord& coord) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pending_.find(coord);
+        if (it != pending_.end()) {
+            return std::make_shared<model>(*it->second);
+        }
+    }
+    
+    region_file* region = get_region(region_file::region_of(coord), false);
+    if (!region) return nullptr;
+    
+    std::shared_ptr<model> result;
+    region->read_chunk(region_file::chunk_index(coord), [&result](const uint8* data, size_t size) {
+        result = chunk_codec::decode(data, size);
+    });
+    return result;
+}
+
+void world_storage::save_chunks_async(std::vector<chunk_snapshot> chunks) {
+    if (chunks.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [coord, snapshot] : chunks) {
+            pending_[coord] = std::move(snapshot);
+        }
+    }
+    writer_cv_.notify_one();
+}
+
+void world_storage::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    flushed_cv_.wait(lock, [this] { return pending_.empty() && !writing_; });
+}
+
+size_t world_storage::get_pending_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+void world_storage::save(world& world) {
+    save_chunks_async(world.take_unsaved_chunks());
+    last_autosave_ = std::chrono::steady_clock::now();
+}
+
+void world_storage::update(world& world) {
+    if (std::chrono::steady_clock::now() - last_autosave_ >= autosave_interval_) {
+        save(world);
+    }
+}
+
+region_file* world_storage::get_region(const chunk_coord& region, bool create) {
+    std::lock_guard<std::mutex> lock(regions_mutex_);
+    
+    auto it = regions_.find(region);
+    if (it != regions_.end()) {
+        return it->second.get();
+    }
+    
+    const std::filesystem::path file_path = path_ / (
+        "r." + std::to_string(region.x) + "." + std::to_string(region.y) + "." + std::to_string(region.z) + ".vxr"
+    );
+    if (!create && !std::filesystem::exists(file_path)) {
+        return nullptr;
+    }
+    
+    auto file = std::make_unique<region_file>(file_path);
+    region_file* result = file.get();
+    regions_.emplace(region, std::move(file));
+    return result;
+}
+
+void world_storage::writer_function() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        writer_cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+        if (pending_.empty()) return;
+        
+        std::vector<chunk_snapshot> batch(pending_.begin(), pending_.end());
+        writing_ = true;
+        lock.unlock();
+        
+        // Кодирование и запись вне блокировки, по одной пачке на регион
+        std::unordered_map<chunk_coord, std::vector<std::pair<int, std::vector<uint8>>>, chunk_coord_hash> regions;
+        for (const auto& [coord, snapshot] : batch) {
+            regions[region_file::region_of(coord)].emplace_back(region_file::chunk_index(coord), chunk_codec::encode(*snapshot));
+        }
+        for (const auto& [region, chunks] : regions) {
+            try {
+                get_region(region, true)->write_chunks(chunks);
+            } catch (const std::exception& e) {
+                std::cerr << "Ошибка сохранения региона: " << e.what() << std::endl;
+            }
+        }
+        
+        lock.lock();
+        
+        // Снимки, замененные за время записи, остаются в очереди
+        for (const auto& [coord, snapshot] : batch) {
+            auto it = pending_.find(coord);
+            if (it != pending_.end() && it->second == snapshot) {
+                pending_.erase(it);
+            }
+        }
+        writing_ = false;
+        flushed_cv_.notify_all();
+    }
+}
+
+} // namespace voxel
@@ -1,13 +1,12 @@
 #version 450
 
-// Входные данные от вертексов
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in uint inColor;
+// Упакованная вершина: x.x - координаты по 10 бит, x.y - цвет RGB и направление грани
+layout(location = 0) in uvec2 inPacked;
 
-// Push constants для матрицы модели
+// Push constants: матрица модели и матрица нормалей, посчитанная на CPU
 layout(push_constant) uniform PushConstants {
     mat4 model;
+    mat3 normal;
 } push;
 
 // Uniform buffer object
@@ -27,23 +26,39 @@ layout(location = 3) out vec3 viewPos;
 layout(location = 4) out vec3 lightPos;
 layout(location = 5) out vec3 lightColor;
 
+// Нормали по направлениям граней: +X, -X, +Y, -Y, +Z, -Z
+const vec3 faceNormals[6] = vec3[](
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0)
+);
+
+vec3 unpackPosition(uint packedPosition) {
+    return vec3(
+        float(packedPosition & 0x3FF),
+        float((packedPosition >> 10) & 0x3FF),
+        float((packedPosition >> 20) & 0x3FF)
+    );
+}
+
 vec3 unpackColor(uint packedColor) {
-    float r = float((packedColor >> 24) & 0xFF) / 255.0;
-    float g = float((packedColor >> 16) & 0xFF) / 255.0;
-    float b = float((packedColor >> 8) & 0xFF) / 255.0;
+    float r = float((packedColor >> 16) & 0xFF) / 255.0;
+    float g = float((packedColor >> 8) & 0xFF) / 255.0;
+    float b = float(packedColor & 0xFF) / 255.0;
     return vec3(r, g, b);
 }
 
 void main() {
     // Трансформация позиции
-    vec4 worldPos = push.model * vec4(inPosition, 1.0);
+    vec4 worldPos = push.model * vec4(unpackPosition(inPacked.x), 1.0);
     fragPos = worldPos.xyz;
     
     // Трансформация нормали
-    fragNormal = normalize(mat3(transpose(inverse(push.model))) * inNormal);
+    vec3 normal = faceNormals[(inPacked.y >> 24) & 0x7];
+    fragNormal = normalize(push.normal * normal);
     
     // Распаковка цвета
-    fragColor = unpackColor(inColor);
+    fragColor = unpackColor(inPacked.y);
     
     // Передача данных освещения
     viewPos = ubo.viewPos;
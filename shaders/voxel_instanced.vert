@@ -0,0 +1,77 @@
+#version 450
+
+// Упакованная вершина: x.x - координаты по 10 бит, x.y - цвет RGB и направление грани
+layout(location = 0) in uvec2 inPacked;
+
+// Матрицы экземпляров: экземпляры меша занимают подряд идущие элементы,
+// начиная с firstInstance команды отрисовки. Матрица нормалей посчитана на CPU
+struct InstanceTransform {
+    mat4 model;
+    mat3 normal;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer InstanceTransforms {
+    InstanceTransform instances[];
+} transforms;
+
+// Uniform buffer object
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+} ubo;
+
+// Выходные данные для fragment shader
+layout(location = 0) out vec3 fragPos;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec3 fragColor;
+layout(location = 3) out vec3 viewPos;
+layout(location = 4) out vec3 lightPos;
+layout(location = 5) out vec3 lightColor;
+
+// Нормали по направлениям граней: +X, -X, +Y, -Y, +Z, -Z
+const vec3 faceNormals[6] = vec3[](
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0)
+);
+
+vec3 unpackPosition(uint packedPosition) {
+    return vec3(
+        float(packedPosition & 0x3FF),
+        float((packedPosition >> 10) & 0x3FF),
+        float((packedPosition >> 20) & 0x3FF)
+    );
+}
+
+vec3 unpackColor(uint packedColor) {
+    float r = float((packedColor >> 16) & 0xFF) / 255.0;
+    float g = float((packedColor >> 8) & 0xFF) / 255.0;
+    float b = float(packedColor & 0xFF) / 255.0;
+    return vec3(r, g, b);
+}
+
+void main() {
+    mat4 model = transforms.instances[gl_InstanceIndex].model;
+    
+    // Трансформация позиции
+    vec4 worldPos = model * vec4(unpackPosition(inPacked.x), 1.0);
+    fragPos = worldPos.xyz;
+    
+    // Трансформация нормали
+    vec3 normal = faceNormals[(inPacked.y >> 24) & 0x7];
+    fragNormal = normalize(transforms.instances[gl_InstanceIndex].normal * normal);
+    
+    // Распаковка цвета
+    fragColor = unpackColor(inPacked.y);
+    
+    // Передача данных освещения
+    viewPos = ubo.viewPos;
+    lightPos = ubo.lightPos;
+    lightColor = ubo.lightColor;
+    
+    // Финальная позиция вершины
+    gl_Position = ubo.proj * ubo.view * worldPos;
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#version 450
+
+// Вытягивание вершин: на квад 6 вершин (два треугольника), данные квада
+// читаются из storage buffer по gl_VertexIndex, вершинных буферов нет
+struct PackedQuad {
+    uint position;  // минимальный угол x, y, z по 10 бит
+    uint size;      // размеры по x, y, z по 10 бит
+    uint colorFace; // цвет RGB и направление грани << 24
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer QuadBuffer {
+    PackedQuad quads[];
+};
+
+// Push constants: матрица модели и матрица нормалей, посчитанная на CPU
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    mat3 normal;
+} push;
+
+// Uniform buffer object
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+    vec3 viewPos;
+    vec3 lightPos;
+    vec3 lightColor;
+} ubo;
+
+// Выходные данные для fragment shader
+layout(location = 0) out vec3 fragPos;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec3 fragColor;
+layout(location = 3) out vec3 viewPos;
+layout(location = 4) out vec3 lightPos;
+layout(location = 5) out vec3 lightColor;
+
+// Нормали по направлениям граней: +X, -X, +Y, -Y, +Z, -Z
+const vec3 faceNormals[6] = vec3[](
+    vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0)
+);
+
+// Углы куба для вершин грани - тот же порядок, что в greedy_mesh_generator::add_quad.
+// Угол c: x = ((c + 1) >> 1) & 1, y = (c >> 1) & 1, z = c >> 2
+const uint faceCorners[24] = uint[](
+    1, 5, 6, 2,  // +X
+    0, 3, 7, 4,  // -X
+    3, 2, 6, 7,  // +Y
+    0, 4, 5, 1,  // -Y
+    4, 7, 6, 5,  // +Z
+    1, 2, 3, 0   // -Z
+);
+
+// Вершины квада для двух треугольников
+const uint quadVertices[6] = uint[](0, 1, 2, 2, 3, 0);
+
+vec3 unpackPosition(uint packedPosition) {
+    return vec3(
+        float(packedPosition & 0x3FF),
+        float((packedPosition >> 10) & 0x3FF),
+        float((packedPosition >> 20) & 0x3FF)
+    );
+}
+
+vec3 unpackColor(uint packedColor) {
+    float r = float((packedColor >> 16) & 0xFF) / 255.0;
+    float g = float((packedColor >> 8) & 0xFF) / 255.0;
+    float b = float(packedColor & 0xFF) / 255.0;
+    return vec3(r, g, b);
+}
+
+void main() {
+    PackedQuad quad = quads[gl_VertexIndex / 6];
+    uint face = (quad.colorFace >> 24) & 0x7;
+    uint corner = faceCorners[face * 4 + quadVertices[gl_VertexIndex % 6]];
+    
+    vec3 cornerMask = vec3(float(((corner + 1) >> 1) & 1), float((corner >> 1) & 1), float(corner >> 2));
+    vec3 position = unpackPosition(quad.position) + unpackPosition(quad.size) * cornerMask;
+    
+    // Трансформация позиции
+    vec4 worldPos = push.model * vec4(position, 1.0);
+    fragPos = worldPos.xyz;
+    
+    // Трансформация нормали
+    fragNormal = normalize(push.normal * faceNormals[face]);
+    
+    // Распаковка цвета
+    fragColor = unpackColor(quad.colorFace);
+    
+    // Передача данных освещения
+    viewPos = ubo.viewPos;
+    lightPos = ubo.lightPos;
+    lightColor = ubo.lightColor;
+    
+    // Финальная позиция вершины
+    gl_Position = ubo.proj * ubo.view * worldPos;
+}